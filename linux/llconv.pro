@@ -11,18 +11,26 @@ VPATH += ../source/
 SOURCES += llconv.cpp
 
 HEADERS += \
+    ascii.hpp \
     basic-parser.hpp \
     debug.hpp \
     format_string.hpp \
     h-parser.hpp \
+    ipc.hpp \
     keyvals.hpp \
+    manifest.hpp \
+    parallel.hpp \
     plc-elements.hpp \
     plclib-writer.hpp \
     pll-parser.hpp \
     pll-writer.hpp \
+    simd-scan.hpp \
     sipro.hpp \
+    stats.hpp \
     string-utilities.hpp \
-    system.hpp
+    system.hpp \
+    tar.hpp \
+    uring.hpp
 
 
 DEFINES -= UNICODE
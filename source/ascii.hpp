@@ -0,0 +1,78 @@
+#ifndef GUARD_ascii_hpp
+#define GUARD_ascii_hpp
+/*  ---------------------------------------------
+    ©2022 matteo.gattanini@gmail.com
+
+    OVERVIEW
+    ---------------------------------------------
+    Classification of characters with a table
+    built at compile time, not depending on the
+    locale and safe with negative 'char' values
+
+    CONSTRAINTS
+    ---------------------------------------------
+    Classes of the "C" locale, no multibyte chars
+
+    DEPENDENCIES:
+    --------------------------------------------- */
+#include <cstdint> // std::uint8_t
+#include <array>
+
+
+//:::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+namespace ascii //:::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+{
+
+enum : std::uint8_t
+{
+    blank = 0x01, // ' ', '\t', '\v', '\f', '\r'
+    newline = 0x02, // '\n'
+    digit = 0x04, // '0'...'9'
+    alpha = 0x08, // 'a'...'z', 'A'...'Z'
+    underscore = 0x10, // '_'
+    xml_special = 0x20 // '<', '>', '&', '\'', '\"'
+};
+
+
+//---------------------------------------------------------------------------
+inline constexpr std::array<std::uint8_t,256> classes = []() consteval
+   {
+    std::array<std::uint8_t,256> tbl{};
+    for( const unsigned char c : {' ', '\t', '\v', '\f', '\r'} ) tbl[c] |= blank;
+    tbl['\n'] |= newline;
+    for( unsigned char c='0'; c<='9'; ++c ) tbl[c] |= digit;
+    for( unsigned char c='a'; c<='z'; ++c ) tbl[c] |= alpha;
+    for( unsigned char c='A'; c<='Z'; ++c ) tbl[c] |= alpha;
+    tbl['_'] |= underscore;
+    for( const unsigned char c : {'<', '>', '&', '\'', '\"'} ) tbl[c] |= xml_special;
+    return tbl;
+   }();
+
+
+//---------------------------------------------------------------------------
+[[nodiscard]] constexpr bool is(const char c, const std::uint8_t cls) noexcept
+{
+    return (classes[static_cast<unsigned char>(c)] & cls) != 0;
+}
+
+[[nodiscard]] constexpr bool is_blank(const char c) noexcept { return is(c, blank); }
+[[nodiscard]] constexpr bool is_space(const char c) noexcept { return is(c, blank | newline); }
+[[nodiscard]] constexpr bool is_digit(const char c) noexcept { return is(c, digit); }
+[[nodiscard]] constexpr bool is_alnum(const char c) noexcept { return is(c, alpha | digit); }
+[[nodiscard]] constexpr bool is_ident_start(const char c) noexcept { return is(c, alpha | underscore); }
+[[nodiscard]] constexpr bool is_ident(const char c) noexcept { return is(c, alpha | digit | underscore); }
+[[nodiscard]] constexpr bool is_xml_special(const char c) noexcept { return is(c, xml_special); }
+
+//---------------------------------------------------------------------------
+[[nodiscard]] constexpr char to_lower(const char c) noexcept
+{
+    return (c>='A' && c<='Z') ? static_cast<char>(c | 0x20) : c;
+}
+
+
+}//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+
+
+//---- end unit -------------------------------------------------------------
+#endif
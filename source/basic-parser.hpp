@@ -14,14 +14,20 @@
 
     DEPENDENCIES:
     --------------------------------------------- */
-#include <cctype> // std::isdigit, std::isblank, ...
 #include <string_view>
+#include <vector>
+#include <array>
+#include <utility> // std::pair
+#include <optional>
+#include <algorithm> // std::ranges::lower_bound
 #include <stdexcept> // std::exception, std::runtime_error, ...
 #include <charconv> // std::from_chars
 //#include <algorithm> // std::min
 #include <fmt/core.h> // fmt::format
 
 #include "string-utilities.hpp" // str::escape
+#include "ascii.hpp" // ascii::*
+#include "simd-scan.hpp" // scan::*
 #include "debug.hpp" // DBGLOG
 
 using namespace std::literals; // "..."sv
@@ -56,6 +62,43 @@ class parse_error final : public std::exception
 
 
 
+/////////////////////////////////////////////////////////////////////////////
+// A set of keywords recognized with a single lookup in a table indexed
+// by a perfect hash, checked at compile time. The value-initialized 'E'
+// stands for a word that's not a keyword
+template<typename E, std::size_t N> class Keywords final
+{
+ public:
+    consteval explicit Keywords(const std::array<std::pair<std::string_view,E>,N>& kws)
+       {
+        for( const auto& kw : kws )
+           {
+            auto& slot = i_slots[hash(kw.first)];
+            if( !slot.first.empty() ) throw "Keywords hash collision, change hash()";
+            slot = kw;
+           }
+       }
+
+    [[nodiscard]] constexpr E find(const std::string_view s) const noexcept
+       {
+        const auto& slot = i_slots[hash(s)];
+        return slot.first==s ? slot.second : E{};
+       }
+
+ private:
+    static constexpr std::size_t slots_count = 32; // Power of two
+    std::array<std::pair<std::string_view,E>,slots_count> i_slots{};
+
+    [[nodiscard]] static constexpr std::size_t hash(const std::string_view s) noexcept
+       {
+        if( s.empty() ) return 0;
+        auto c = [&s](const std::size_t idx) noexcept { return static_cast<std::size_t>(static_cast<unsigned char>(s[idx])); };
+        return (s.size() + c(0) + 7u*c(s.size()-1) + c(s.size()/2)) & (slots_count-1u);
+       }
+};
+
+
+
 /////////////////////////////////////////////////////////////////////////////
 class BasicParser
 {
@@ -64,8 +107,8 @@ class BasicParser
     const char* const buf;
     const std::size_t siz; // buffer size
     const std::size_t i_last; // index of the last character
-    std::size_t line; // Current line number
     std::size_t i; // Current character
+    mutable std::optional<std::vector<std::size_t>> newlines; // Offsets of '\n', indexed when a line is needed
     std::vector<std::string>& issues; // Problems found
     const bool fussy;
 
@@ -78,7 +121,6 @@ class BasicParser
       , buf(dat.data())
       , siz(dat.size())
       , i_last(siz-1u) // siz>0
-      , line(1)
       , i(0)
       , issues(lst)
       , fussy(fus)
@@ -113,20 +155,34 @@ class BasicParser
 
     //-----------------------------------------------------------------------
     [[nodiscard]] bool end_not_reached() const noexcept { return i<siz; }
-    [[nodiscard]] std::size_t curr_line() const noexcept { return line; }
+    [[nodiscard]] std::size_t curr_line() const noexcept { return line_of(i); }
     [[nodiscard]] std::size_t curr_pos() const noexcept { return i; }
 
 
     //-----------------------------------------------------------------------
     parse_error create_parse_error(const std::string_view msg) const noexcept
        {
-        return parse_error(msg, file_path, line, i<=i_last ? i : i_last);
+        return create_parse_error(msg, i);
        }
 
     //-----------------------------------------------------------------------
-    parse_error create_parse_error(const std::string_view msg, const std::size_t lin, const std::size_t off) const noexcept
+    parse_error create_parse_error(const std::string_view msg, const std::size_t off) const noexcept
        {
-        return parse_error(msg, file_path, lin, off<=i_last ? off : i_last);
+        return parse_error(msg, file_path, line_of(off), off<=i_last ? off : i_last);
+       }
+
+    //-----------------------------------------------------------------------
+    // Line number of an offset: the scanning loops don't count
+    // the lines, the line ends are indexed at the first request
+    [[nodiscard]] std::size_t line_of(const std::size_t off) const noexcept
+       {
+        if( !newlines )
+           {
+            newlines.emplace();
+            std::size_t j = 0;
+            while( (j = scan::find(buf, j, siz, '\n'))<siz ) newlines->push_back(j++);
+           }
+        return 1u + static_cast<std::size_t>(std::ranges::lower_bound(*newlines, off) - newlines->begin());
        }
 
     //-----------------------------------------------------------------------
@@ -139,10 +195,13 @@ class BasicParser
     //    else issues.push_back( fmt::format("{} (line {}, offset {})", fmt::format(fmt::runtime(msg), args...), line, i) );
     //   }
     // consteval friendly:
+    // Note: the message is formatted first, since its arguments
+    //       may move the position (ex. 'skip_line()')
     #define notify_error(...) \
        {\
-        if(fussy) throw create_parse_error( fmt::format(__VA_ARGS__) );\
-        else issues.push_back( fmt::format("{} (line {}, offset {})"sv, fmt::format(__VA_ARGS__), line, i) );\
+        std::string notify_msg_{ fmt::format(__VA_ARGS__) };\
+        if(fussy) throw create_parse_error(notify_msg_);\
+        else issues.push_back( fmt::format("{} (line {}, offset {})"sv, notify_msg_, curr_line(), i) );\
        }
 
 
@@ -150,7 +209,7 @@ class BasicParser
     //-----------------------------------------------------------------------
     [[nodiscard]] static bool is_blank(const char c) noexcept
        {
-        return std::isspace(c) && c!='\n';
+        return ascii::is_blank(c);
        }
 
 
@@ -158,7 +217,7 @@ class BasicParser
     // Skip space chars except new line
     void skip_blanks() noexcept
        {
-        while( i<siz && is_blank(buf[i]) ) ++i;
+        i = scan::skip_blanks(buf, i, siz);
        }
 
 
@@ -169,7 +228,6 @@ class BasicParser
         if( buf[i]=='\n' )
            {
             ++i;
-            ++line;
             return true;
            }
         return false;
@@ -203,7 +261,8 @@ class BasicParser
         if(i>i_last) return std::string_view(buf+i_last, 0);
 
         const std::size_t i_start = i;
-        while( i<siz && !eat_line_end() ) ++i;
+        i = scan::find(buf, i, siz, '\n');
+        if( i<siz ) eat_line_end();
         return std::string_view(buf+i_start, i-i_start);
         // Note: If '\n' not found is i==siz and returns what remains in buf
        }
@@ -226,7 +285,7 @@ class BasicParser
     [[nodiscard]] bool eat_token(const std::string_view s) noexcept
        {
         const std::size_t i_end = i+s.length();
-        if( ((i_end<siz && !std::isalnum(buf[i_end])) || i_end==siz) && s==std::string_view(buf+i,s.length()) )
+        if( ((i_end<siz && !ascii::is_alnum(buf[i_end])) || i_end==siz) && s==std::string_view(buf+i,s.length()) )
            {
             i = i_end;
             return true;
@@ -239,7 +298,7 @@ class BasicParser
     [[nodiscard]] std::string_view collect_token() noexcept
        {
         const std::size_t i_start = i;
-        while( i<siz && !std::isspace(buf[i]) ) ++i;
+        i = scan::find_space(buf, i, siz);
         return std::string_view(buf+i_start, i-i_start);
        }
 
@@ -248,7 +307,7 @@ class BasicParser
     [[nodiscard]] std::string_view collect_identifier() noexcept
        {
         const std::size_t i_start = i;
-        while( i<siz && (std::isalnum(buf[i]) || buf[i]=='_') ) ++i;
+        i = scan::skip_identifier(buf, i, siz);
         return std::string_view(buf+i_start, i-i_start);
        }
 
@@ -257,7 +316,7 @@ class BasicParser
     [[nodiscard]] std::string_view collect_numeric_value() noexcept
        {
         const std::size_t i_start = i;
-        while( i<siz && (std::isdigit(buf[i]) || buf[i]=='+' || buf[i]=='-' || buf[i]=='.' || buf[i]=='E') ) ++i;
+        while( i<siz && (ascii::is_digit(buf[i]) || buf[i]=='+' || buf[i]=='-' || buf[i]=='.' || buf[i]=='E') ) ++i;
         return std::string_view(buf+i_start, i-i_start);
        }
 
@@ -266,7 +325,7 @@ class BasicParser
     [[nodiscard]] std::string_view collect_digits() noexcept
        {
         const std::size_t i_start = i;
-        while( i<siz && std::isdigit(buf[i]) ) ++i;
+        while( i<siz && ascii::is_digit(buf[i]) ) ++i;
         return std::string_view(buf+i_start, i-i_start);
        }
 
@@ -291,13 +350,13 @@ class BasicParser
            {
             throw create_parse_error("Negative index");
            }
-        if( !std::isdigit(buf[i]) )
+        if( !ascii::is_digit(buf[i]) )
            {
             throw create_parse_error(fmt::format("Invalid char \'{}\' in index", buf[i]));
            }
         std::size_t result = (buf[i]-'0');
         const std::size_t base = 10u;
-        while( ++i<siz && std::isdigit(buf[i]) )
+        while( ++i<siz && ascii::is_digit(buf[i]) )
            {
             result = (base*result) + (buf[i]-'0');
            }
@@ -332,13 +391,13 @@ class BasicParser
                 throw create_parse_error("Invalid integer \'-\'");
                }
            }
-        if( !std::isdigit(buf[i]) )
+        if( !ascii::is_digit(buf[i]) )
            {
             throw create_parse_error(fmt::format("Invalid char \'{}\' in integer", buf[i]));
            }
         int result = (buf[i]-'0');
         const int base = 10;
-        while( ++i<siz && std::isdigit(buf[i]) )
+        while( ++i<siz && ascii::is_digit(buf[i]) )
            {
             result = (base*result) + (buf[i]-'0');
            }
@@ -358,21 +417,21 @@ class BasicParser
     //    // [mantissa - integer part]
     //    double mantissa = 0;
     //    bool found_mantissa = false;
-    //    if( std::isdigit(buf[i]) )
+    //    if( ascii::is_digit(buf[i]) )
     //       {
     //        found_mantissa = true;
     //        do {
     //            mantissa = (10.0 * mantissa) + static_cast<double>(buf[i] - '0');
     //            //if( buf[++i] == '\'' ); // Skip thousand separator char
     //           }
-    //        while( std::isdigit(buf[i]) );
+    //        while( ascii::is_digit(buf[i]) );
     //       }
     //    // [mantissa - fractional part]
     //    if( buf[i] == '.' )
     //       {
     //        ++i;
     //        double k = 0.1; // shift of decimal part
-    //        if( std::isdigit(buf[i]) )
+    //        if( ascii::is_digit(buf[i]) )
     //           {
     //            found_mantissa = true;
     //            do {
@@ -380,7 +439,7 @@ class BasicParser
     //                k *= 0.1;
     //                ++i;
     //               }
-    //            while( std::isdigit(buf[i]) );
+    //            while( ascii::is_digit(buf[i]) );
     //           }
     //       }
     //
@@ -396,14 +455,14 @@ class BasicParser
     //        if( buf[i] == '-' ) {exp_sgn = -1; ++i;}
     //        else if( buf[i] == '+' ) ++i;
     //        // [exponent value]
-    //        if( std::isdigit(buf[i]) )
+    //        if( ascii::is_digit(buf[i]) )
     //           {
     //            found_expval = true;
     //            do {
     //                exp = (10 * exp) + static_cast<int>(buf[i] - '0');
     //                ++i;
     //               }
-    //            while( std::isdigit(buf[i]) );
+    //            while( ascii::is_digit(buf[i]) );
     //           }
     //       }
     //    if( found_expchar && !found_expval )
@@ -470,28 +529,16 @@ class BasicParser
     //-----------------------------------------------------------------------
     [[nodiscard]] std::string_view collect_until_char_trimmed(const char c)
        {
-        const std::size_t line_start = line; // Store current line
-        const std::size_t i_start = i;       // and position
-        std::size_t i_end = i_start; // Index past last char not blank
-        while( i<siz )
+        const std::size_t i_start = i; // Store current position
+        i = scan::find(buf, i, siz, c);
+        if( i<siz )
            {
-            if( buf[i]==c )
-               {
-                //++i; // Nah, do not eat c
-                return std::string_view(buf+i_start, i_end-i_start);
-               }
-            else if( buf[i]=='\n' )
-               {
-                ++line;
-                ++i;
-               }
-            else
-               {
-                if( !is_blank(buf[i]) ) i_end = ++i;
-                else ++i;
-               }
+            //++i; // Nah, do not eat c
+            std::size_t i_end = i; // Index past last char not blank
+            while( i_end>i_start && ascii::is_space(buf[i_end-1]) ) --i_end;
+            return std::string_view(buf+i_start, i_end-i_start);
            }
-        throw create_parse_error(fmt::format("Unclosed content (\'{}\' expected)", str::escape(c)), line_start, i_start);
+        throw create_parse_error(fmt::format("Unclosed content (\'{}\' expected)", str::escape(c)), i_start);
        }
 
 
@@ -516,23 +563,17 @@ class BasicParser
     //-----------------------------------------------------------------------
     [[nodiscard]] std::string_view collect_until_newline_token(const std::string_view tok)
        {
-        const std::size_t line_start = line;
         const std::size_t i_start = i;
-        while( i<siz )
+        while( (i = scan::find(buf, i, siz, '\n'))<siz )
            {
-            if( buf[i]=='\n' )
+            ++i; // Skip '\n'
+            skip_blanks();
+            if( eat_token(tok) )
                {
-                ++i;
-                ++line;
-                skip_blanks();
-                if( eat_token(tok) )
-                   {
-                    return std::string_view(buf+i_start, i-i_start-tok.length());
-                   }
+                return std::string_view(buf+i_start, i-i_start-tok.length());
                }
-            else ++i;
            }
-        throw create_parse_error(fmt::format("Unclosed content (\"{}\" expected)",tok), line_start, i_start);
+        throw create_parse_error(fmt::format("Unclosed content (\"{}\" expected)",tok), i_start);
        }
 
 
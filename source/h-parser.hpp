@@ -10,7 +10,6 @@
 
     DEPENDENCIES:
     --------------------------------------------- */
-#include <cctype> // std::isdigit, std::isblank, ...
 #include <string_view>
 #include <stdexcept> // std::exception, std::runtime_error, ...
 #include <charconv> // std::from_chars
@@ -161,22 +160,14 @@ class Parser final : public BasicParser
     //-----------------------------------------------------------------------
     void skip_block_comment()
        {
-        const std::size_t line_start = line; // Store current line
         const std::size_t i_start = i; // Store current position
-        while( i<i_last )
+        i = scan::find_pair(buf, i, siz, '*', '/');
+        if( i<siz )
            {
-            if( buf[i]=='*' && buf[i+1]=='/' )
-               {
-                i += 2; // Skip "*/"
-                return;
-               }
-            else if( buf[i]=='\n' )
-               {
-                ++line;
-               }
-            ++i;
+            i += 2; // Skip "*/"
+            return;
            }
-        throw create_parse_error("Unclosed block comment", line_start, i_start);
+        throw create_parse_error("Unclosed block comment", i_start);
        }
 
 
@@ -0,0 +1,308 @@
+#ifndef GUARD_ipc_hpp
+#define GUARD_ipc_hpp
+/*  ---------------------------------------------
+    ©2022 matteo.gattanini@gmail.com
+
+    OVERVIEW
+    ---------------------------------------------
+    Local (Unix domain) socket carrying frames:
+    <tag:1 byte> <length:4 bytes little endian> <payload>
+    The socket file is accessible just by the owner,
+    connections of other users can be rejected
+
+    DEPENDENCIES:
+    --------------------------------------------- */
+#include "system.hpp" // MS_WINDOWS, fs::*
+
+#ifndef MS_WINDOWS
+  #include <sys/socket.h> // socket, bind, listen, accept, connect, send, recv
+  #include <sys/un.h> // sockaddr_un
+  #include <sys/stat.h> // lstat, umask
+  #include <unistd.h> // close, unlink, geteuid
+#endif
+#include <cerrno> // errno
+#include <cstdint> // std::uint32_t
+#include <cstring> // std::memcpy
+#include <string>
+#include <string_view>
+#include <optional>
+#include <utility> // std::exchange
+#include <streambuf> // std::streambuf
+#include <stdexcept> // std::runtime_error
+
+
+//:::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+namespace ipc //:::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+{
+
+//---------------------------------------------------------------------------
+enum class Tag : char
+{
+    cwd = 'd', // Client working directory
+    arg = 'a', // A command line argument
+    run = 'r', // End of request
+    out = 'o', // A chunk of standard output
+    err = 'e', // A chunk of standard error
+    exit = 'x' // Exit code, end of response
+};
+
+struct Frame
+{
+    Tag tag;
+    std::string payload;
+};
+
+
+/////////////////////////////////////////////////////////////////////////////
+class Socket final
+{
+ public:
+    static constexpr std::size_t max_payload_size = 64u * 1024u * 1024u;
+
+    //-----------------------------------------------------------------------
+    // Listen on a filesystem path, a stale socket file is replaced
+    // but not any other file nor a socket of a running server
+    [[nodiscard]] static Socket listen(const std::string& pth)
+       {
+      #ifdef MS_WINDOWS
+        throw std::runtime_error("Local sockets not yet supported on Windows");
+      #else
+        Socket sock = create();
+        const sockaddr_un addr = make_address(pth);
+        if( struct stat st{}; ::lstat(pth.c_str(), &st)==0 )
+           {
+            if( !S_ISSOCK(st.st_mode) ) throw std::runtime_error("Not a socket, won't be replaced: " + pth);
+            if( create().connects_to(addr) ) throw std::runtime_error("Already served: " + pth);
+            ::unlink(pth.c_str());
+           }
+        const ::mode_t prev_mask = ::umask(0177); // Socket file created as 0600
+        const bool bound = ::bind(sock.i_fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr))!=-1;
+        ::umask(prev_mask);
+        if( !bound || ::listen(sock.i_fd, 16)==-1 )
+           {
+            throw std::runtime_error("Cannot listen on " + pth);
+           }
+        return sock;
+      #endif
+       }
+
+    //-----------------------------------------------------------------------
+    [[nodiscard]] static Socket connect(const std::string& pth)
+       {
+      #ifdef MS_WINDOWS
+        throw std::runtime_error("Local sockets not yet supported on Windows");
+      #else
+        Socket sock = create();
+        if( !sock.connects_to(make_address(pth)) )
+           {
+            throw std::runtime_error("Cannot connect to " + pth);
+           }
+        return sock;
+      #endif
+       }
+
+    ~Socket() noexcept
+       {
+      #ifndef MS_WINDOWS
+        if( i_fd!=-1 ) ::close(i_fd);
+      #endif
+       }
+
+    Socket(const Socket&) = delete;
+    Socket& operator=(const Socket&) = delete;
+    Socket(Socket&& other) noexcept : i_fd(std::exchange(other.i_fd, -1)) {}
+    Socket& operator=(Socket&&) = delete;
+
+    //-----------------------------------------------------------------------
+    [[nodiscard]] Socket accept() const
+       {
+      #ifndef MS_WINDOWS
+        while( true )
+           {
+            const int fd = ::accept(i_fd, nullptr, nullptr);
+            if( fd!=-1 ) return Socket(fd);
+            if( errno!=EINTR && errno!=ECONNABORTED ) throw std::runtime_error("Cannot accept connections");
+           }
+      #else
+        return Socket(-1);
+      #endif
+       }
+
+    //-----------------------------------------------------------------------
+    // Tell if the connected peer runs as the same user of this process
+    [[nodiscard]] bool is_peer_same_user() const noexcept
+       {
+      #if defined(MS_WINDOWS)
+        return false;
+      #elif defined(SO_PEERCRED)
+        ::ucred cred{};
+        ::socklen_t len = sizeof(cred);
+        return ::getsockopt(i_fd, SOL_SOCKET, SO_PEERCRED, &cred, &len)==0 && cred.uid==::geteuid();
+      #else
+        ::uid_t uid = 0;
+        ::gid_t gid = 0;
+        return ::getpeereid(i_fd, &uid, &gid)==0 && uid==::geteuid();
+      #endif
+       }
+
+    //-----------------------------------------------------------------------
+    void send_frame(const Tag tag, const std::string_view payload) const
+       {
+        if( payload.size()>max_payload_size ) throw std::runtime_error("Frame too big");
+        const auto len = static_cast<std::uint32_t>(payload.size());
+        const char header[5] = { static_cast<char>(tag),
+                                 static_cast<char>(len & 0xFFu),
+                                 static_cast<char>((len >> 8) & 0xFFu),
+                                 static_cast<char>((len >> 16) & 0xFFu),
+                                 static_cast<char>((len >> 24) & 0xFFu) };
+        send_all(header, sizeof(header));
+        send_all(payload.data(), payload.size());
+       }
+
+    //-----------------------------------------------------------------------
+    // Returns nothing if the peer closed the connection
+    [[nodiscard]] std::optional<Frame> recv_frame() const
+       {
+        unsigned char header[5];
+        if( !recv_all(reinterpret_cast<char*>(header), sizeof(header)) ) return std::nullopt;
+        const std::uint32_t len = static_cast<std::uint32_t>(header[1])
+                                | static_cast<std::uint32_t>(header[2]) << 8
+                                | static_cast<std::uint32_t>(header[3]) << 16
+                                | static_cast<std::uint32_t>(header[4]) << 24;
+        if( len>max_payload_size ) throw std::runtime_error("Frame too big");
+        Frame frame{ static_cast<Tag>(header[0]), std::string(len, '\0') };
+        if( !recv_all(frame.payload.data(), len) ) throw std::runtime_error("Truncated frame");
+        return frame;
+       }
+
+ private:
+    int i_fd = -1;
+
+    explicit Socket(const int fd) noexcept : i_fd(fd) {}
+
+  #ifndef MS_WINDOWS
+    //-----------------------------------------------------------------------
+    [[nodiscard]] static Socket create()
+       {
+        const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if( fd==-1 ) throw std::runtime_error("Cannot create socket");
+        return Socket(fd);
+       }
+
+    //-----------------------------------------------------------------------
+    [[nodiscard]] bool connects_to(const sockaddr_un& addr) const noexcept
+       {
+        return ::connect(i_fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr))!=-1;
+       }
+
+    //-----------------------------------------------------------------------
+    [[nodiscard]] static sockaddr_un make_address(const std::string& pth)
+       {
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        if( pth.size()>=sizeof(addr.sun_path) ) throw std::runtime_error("Socket path too long: " + pth);
+        std::memcpy(addr.sun_path, pth.c_str(), pth.size()+1);
+        return addr;
+       }
+  #endif
+
+    //-----------------------------------------------------------------------
+    void send_all(const char* buf, std::size_t siz) const
+       {
+      #ifndef MS_WINDOWS
+        while( siz>0 )
+           {
+            const ssize_t n = ::send(i_fd, buf, siz, MSG_NOSIGNAL);
+            if( n==-1 )
+               {
+                if( errno==EINTR ) continue;
+                throw std::runtime_error("Connection lost");
+               }
+            buf += n;
+            siz -= static_cast<std::size_t>(n);
+           }
+      #endif
+       }
+
+    //-----------------------------------------------------------------------
+    // Returns false if the peer closed the connection before the start
+    [[nodiscard]] bool recv_all(char* buf, const std::size_t siz) const
+       {
+      #ifndef MS_WINDOWS
+        std::size_t got = 0;
+        while( got<siz )
+           {
+            const ssize_t n = ::recv(i_fd, buf+got, siz-got, 0);
+            if( n==0 )
+               {
+                if( got==0 ) return false;
+                throw std::runtime_error("Truncated frame");
+               }
+            if( n==-1 )
+               {
+                if( errno==EINTR ) continue;
+                throw std::runtime_error("Connection lost");
+               }
+            got += static_cast<std::size_t>(n);
+           }
+      #endif
+        return true;
+       }
+};
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Stream buffer that sends its content as frames of a given tag,
+// to plug a socket into a std::ostream
+class FramesStreamBuf final : public std::streambuf
+{
+ public:
+    FramesStreamBuf(const Socket& sock, const Tag tag) noexcept
+      : i_sock(sock)
+      , i_tag(tag)
+       {
+        setp(i_buf, i_buf+sizeof(i_buf));
+       }
+
+ protected:
+    int_type overflow(const int_type ch) override
+       {
+        if( sync()!=0 ) return traits_type::eof();
+        if( !traits_type::eq_int_type(ch, traits_type::eof()) )
+           {
+            *pptr() = traits_type::to_char_type(ch);
+            pbump(1);
+           }
+        return traits_type::not_eof(ch);
+       }
+
+    int sync() override
+       {
+        const std::size_t siz = static_cast<std::size_t>(pptr()-pbase());
+        if( siz>0 )
+           {
+            try{
+                i_sock.send_frame(i_tag, std::string_view(pbase(), siz));
+               }
+            catch(...)
+               {
+                return -1;
+               }
+            setp(i_buf, i_buf+sizeof(i_buf));
+           }
+        return 0;
+       }
+
+ private:
+    const Socket& i_sock;
+    const Tag i_tag;
+    char i_buf[4096];
+};
+
+
+}//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+
+
+//---- end unit -------------------------------------------------------------
+#endif
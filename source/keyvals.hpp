@@ -5,12 +5,13 @@
 
     DEPENDENCIES:
     --------------------------------------------- */
-#include <cctype> // std::isspace, ...
 #include <string>
 #include <string_view>
 #include <map>
 #include <optional>
 
+#include "ascii.hpp" // ascii::is_space
+
 using namespace std::literals; // "..."sv
 
 
@@ -38,13 +39,13 @@ class keyvals final
         while( i<i_end )
            {
             // Skip possible spaces
-            while( i<i_end && std::isspace(s[i]) ) ++i;
+            while( i<i_end && ascii::is_space(s[i]) ) ++i;
             // Get key
             const std::size_t i_k0 = i;
-            while( i<i_end && !std::isspace(s[i]) && s[i]!=sep && s[i]!=':' && s[i]!='=' ) ++i;
+            while( i<i_end && !ascii::is_space(s[i]) && s[i]!=sep && s[i]!=':' && s[i]!='=' ) ++i;
             const std::size_t i_klen = i-i_k0;
             // Skip possible spaces
-            while( i<i_end && std::isspace(s[i]) ) ++i;
+            while( i<i_end && ascii::is_space(s[i]) ) ++i;
             // Get possible value
             std::size_t i_v0=0, i_vlen=0;
             if( s[i]==':' || s[i]=='=' )
@@ -52,13 +53,13 @@ class keyvals final
                 // Skip key/value separator
                 ++i;
                 // Skip possible spaces
-                while( i<i_end && std::isspace(s[i]) ) ++i;
+                while( i<i_end && ascii::is_space(s[i]) ) ++i;
                 // Collect value
                 i_v0 = i;
-                while( i<i_end && !std::isspace(s[i]) && s[i]!=sep ) ++i;
+                while( i<i_end && !ascii::is_space(s[i]) && s[i]!=sep ) ++i;
                 i_vlen = i-i_v0;
                 // Skip possible spaces
-                while( i<i_end && std::isspace(s[i]) ) ++i;
+                while( i<i_end && ascii::is_space(s[i]) ) ++i;
                }
             // Skip possible delimiter
             if( i<i_end && s[i]==sep ) ++i;
@@ -9,12 +9,24 @@
     DEPENDENCIES:
     --------------------------------------------- */
 #include <iostream>
+#include <sstream> // std::ostringstream
 #include <string>
 #include <string_view>
 //#include <span>
 //#include <ranges>
 #include <vector>
+#include <unordered_map>
+#include <map>
+#include <algorithm> // std::ranges::any_of
+#include <iterator> // std::istreambuf_iterator
 #include <stdexcept> // std::runtime_error
+#include <exception> // std::exception_ptr
+#include <memory> // std::unique_ptr
+#include <optional> // std::optional
+#include <thread> // std::thread
+#include <mutex> // std::mutex, std::scoped_lock
+#include <atomic> // std::atomic
+#include <numeric> // std::iota
 #include <fmt/core.h> // fmt::format
 
 #include "system.hpp" // sys::*, fs::*
@@ -23,28 +35,51 @@
 #include "h-parser.hpp" // h::*
 #include "pll-parser.hpp" // pll::*
 #include "plc-elements.hpp" // plcb::*
-#include "plclib-writer.hpp" // plclib::write
-#include "pll-writer.hpp" // pll::write
+#include "plclib-writer.hpp" // plclib::write, plclib::CombinedWriter
+#include "pll-writer.hpp" // pll::write, pll::CombinedWriter
+#include "parallel.hpp" // mt::*
+#include "manifest.hpp" // build::Manifest
+#include "ipc.hpp" // ipc::*
+#include "stats.hpp" // stats::*
+#include "uring.hpp" // aio::*
+#include "tar.hpp" // tar::*
 
 using namespace std::literals; // "..."sv
 
 //#define PLL_TEST // Check *.pll parser and writer
 
+// Identifies the converter in the incremental build manifest
+static constexpr std::string_view build_id = __DATE__ " " __TIME__;
+
 
 /////////////////////////////////////////////////////////////////////////////
 class Arguments final
 {
  public:
-    Arguments(const int argc, const char* const argv[]) // const std::span args
+    enum class IO : std::uint8_t
+       {
+        buffered, // Through a reused buffer
+        mmap, // Sized upfront and filled in memory
+        writev, // Gathered, referencing the input
+        uring // Queued together to io_uring
+       };
+
+    Arguments(const int argc, const char* const argv[], std::ostream& out) // const std::span args
        {
         // Expecting pll file paths
-        i_files.reserve( static_cast<std::size_t>(argc) ); // args.size()
+        i_inputs.reserve( static_cast<std::size_t>(argc) ); // args.size()
         try{
             enum class STS
                {
                 SEE_ARG,
                 GET_OPTS,
-                GET_OUT
+                GET_OUT,
+                GET_JOBS,
+                GET_FILES_FROM,
+                GET_TRACE,
+                GET_IO,
+                GET_FROM,
+                GET_ARCHIVE
                } status = STS::SEE_ARG;
 
             //for( const auto arg : args | std::views::transform([](const char* const a){ return std::string_view(a);}) )
@@ -71,17 +106,70 @@ class Arguments final
                                {
                                 i_clear = true;
                                }
+                            else if( swtch=="incremental"sv )
+                               {
+                                i_incremental = true;
+                               }
+                            else if( swtch=="write-if-changed"sv )
+                               {
+                                i_write_if_changed = true;
+                               }
+                            else if( swtch=="stats"sv )
+                               {
+                                i_stats = true;
+                               }
+                            else if( swtch=="stats-json"sv )
+                               {
+                                i_stats = true;
+                                i_stats_json = true;
+                               }
+                            else if( swtch=="sync"sv )
+                               {
+                                i_sync = true;
+                               }
+                            else if( swtch=="watch"sv )
+                               {
+                                i_watch = true;
+                               }
                             else if( swtch=="options"sv )
                                {
                                 status = STS::GET_OPTS; // stringlist expected
                                }
+                            else if( swtch=="output-archive"sv )
+                               {
+                                status = STS::GET_ARCHIVE; // path expected
+                               }
                             else if( swtch=="output"sv || swtch=="o"sv )
                                {
                                 status = STS::GET_OUT; // path expected
                                }
+                            else if( swtch=="jobs"sv || swtch=="j"sv )
+                               {
+                                status = STS::GET_JOBS; // number expected
+                               }
+                            else if( swtch=="trace"sv )
+                               {
+                                status = STS::GET_TRACE; // path expected
+                               }
+                            else if( swtch=="from"sv )
+                               {
+                                status = STS::GET_FROM; // format expected
+                               }
+                            else if( swtch=="mux"sv )
+                               {
+                                i_mux = true;
+                               }
+                            else if( swtch=="io"sv )
+                               {
+                                status = STS::GET_IO; // method expected
+                               }
+                            else if( swtch=="files-from"sv )
+                               {
+                                status = STS::GET_FILES_FROM; // path expected
+                               }
                             else if( swtch=="help"sv || swtch=="h"sv )
                                {
-                                print_help();
+                                print_help(out);
                                 throw std::invalid_argument("Aborting after printing help");
                                }
                             else
@@ -89,19 +177,21 @@ class Arguments final
                                 throw std::invalid_argument(fmt::format("Unknown command switch: {}",swtch));
                                }
                            }
+                        else if( arg=="-"sv )
+                           {// The standard input
+                            if( i_stdin_listed ) throw std::invalid_argument("Standard input already used");
+                            i_stdin_listed = true;
+                            i_inputs.emplace_back(arg);
+                           }
+                        else if( arg.length()>1 && arg[0]=='@' )
+                           {// A response file
+                            add_inputs_from( arg.substr(1) );
+                           }
                         else
                            {// Probably an input file
-                            //i_files.emplace_back(arg);
                             // Support environment variables? Nah, not very useful, they're already been expanded
                             //const fs::path path = sys::expand_env_variables( std::string(arg) );
-                            // Support globbing (just in file name)
-                            const auto in_paths = sys::file_glob( fs::path(arg) );
-                            if( in_paths.empty() )
-                               {
-                                throw std::invalid_argument(fmt::format("File(s) not found: {}",arg));
-                               }
-                            i_files.reserve(i_files.size() + in_paths.size());
-                            i_files.insert(i_files.end(), in_paths.begin(), in_paths.end());
+                            i_inputs.emplace_back(arg);
                            }
                         break;
 
@@ -111,21 +201,116 @@ class Arguments final
                         break;
 
                     case STS::GET_OUT :
+                        if( arg=="-"sv )
+                           {// Standard output
+                            i_output_stream = &out;
+                            status = STS::SEE_ARG;
+                            break;
+                           }
                         i_output = arg; // Expecting a path
+                        if( !fs::is_directory(i_output) && is_combinable(i_output) )
+                           {// Combine all the libraries in a single file
+                            i_combined_output = i_output;
+                            i_output = i_combined_output.has_parent_path() ? i_combined_output.parent_path() : i_default_output;
+                           }
                         if( !fs::exists(i_output) )
                            {
                             throw std::invalid_argument(fmt::format("Output path doesn't exists: {}",arg));
                             //const bool ok = fs::create_directories(i_output);
                            }
-                        i_output_isdir = fs::is_directory(i_output);
-                        if( !i_output_isdir )
+                        i_output_isdir = i_combined_output.empty() && fs::is_directory(i_output);
+                        if( !i_output_isdir && i_combined_output.empty() )
+                           {
+                            throw std::invalid_argument(fmt::format("Can combine just in a .pll or .plclib file: {}",arg));
+                           }
+                        status = STS::SEE_ARG;
+                        break;
+
+                    case STS::GET_JOBS :
+                        i_jobs = str::to_num<std::size_t>(arg); // Expecting a number
+                        if( i_jobs==0 ) i_jobs = mt::available_cores();
+                        status = STS::SEE_ARG;
+                        break;
+
+                    case STS::GET_TRACE :
+                        i_trace_path = arg; // Expecting a path
+                        status = STS::SEE_ARG;
+                        break;
+
+                    case STS::GET_ARCHIVE :
+                        i_output_archive = arg; // Expecting a path
+                        status = STS::SEE_ARG;
+                        break;
+
+                    case STS::GET_FROM :
+                        if( arg=="pll"sv ) i_from = ".pll"sv;
+                        else if( arg=="h"sv ) i_from = ".h"sv;
+                        else throw std::invalid_argument(fmt::format("Unknown input format: {}",arg));
+                        status = STS::SEE_ARG;
+                        break;
+
+                    case STS::GET_IO :
+                        if( arg=="buffered"sv ) i_io = IO::buffered;
+                        else if( arg=="mmap"sv ) i_io = IO::mmap;
+                        else if( arg=="writev"sv ) i_io = IO::writev;
+                        else if( arg=="uring"sv ) i_io = IO::uring;
+                        else throw std::invalid_argument(fmt::format("Unknown output method: {}",arg));
+                        status = STS::SEE_ARG;
+                        break;
+
+                    case STS::GET_FILES_FROM :
+                        if( arg=="-"sv )
                            {
-                            throw std::invalid_argument(fmt::format("Combine into existing output file not yet supported: {}",arg));
+                            if( i_stdin_listed ) throw std::invalid_argument("Standard input already used");
+                            i_stdin_listed = true;
                            }
+                        add_inputs_from(arg); // Expecting a path or "-"
                         status = STS::SEE_ARG;
                         break;
                    }
                } // each argument
+
+            // Support globbing (just in file name)
+            const auto in_paths = sys::file_glob(i_inputs);
+            for( std::size_t i=0; i<in_paths.size(); ++i )
+               {
+                if( is_stdin(i_inputs[i]) )
+                   {
+                    if( i_from.empty() ) throw std::invalid_argument("Specify the format of the standard input with -from pll|h");
+                    i_files.push_back(i_inputs[i]);
+                    continue;
+                   }
+                if( in_paths[i].empty() )
+                   {
+                    throw std::invalid_argument(fmt::format("File(s) not found: {}",i_inputs[i].string()));
+                   }
+                for( const auto& pth : in_paths[i] )
+                   {
+                    if( str::tolower(pth.extension().string())==".tar"sv ) add_archive_members(pth);
+                    else i_files.push_back(pth);
+                   }
+               }
+            if( i_watch && !i_members.empty() )
+               {
+                throw std::invalid_argument("Cannot watch the members of an archive");
+               }
+            if( !i_output_archive.empty() && (i_output_stream || i_watch) )
+               {
+                throw std::invalid_argument("-output-archive is incompatible with -output - and -watch");
+               }
+            if( !i_combined_output.empty() && (!i_output_archive.empty() || i_watch || i_incremental) )
+               {// All the inputs must be converted each time
+                throw std::invalid_argument("A combined output is incompatible with -output-archive, -watch and -incremental");
+               }
+
+            // More outputs in the standard output must be told apart
+            if( i_output_stream && !i_mux )
+               {
+                if( i_files.size()>1 || std::ranges::any_of(i_files, [this](const fs::path& p){ return input_ext(p)==".h"sv; }) )
+                   {
+                    throw std::invalid_argument("More outputs to standard output need -mux");
+                   }
+               }
            }
         catch( std::exception& e)
            {
@@ -133,9 +318,9 @@ class Arguments final
            }
        }
 
-    static void print_help() noexcept
+    static void print_help(std::ostream& os) noexcept
        {
-        std::cout << "\nllconv (ver. " << __DATE__ << ")\n"
+        os << "\nllconv (ver. " << __DATE__ << ")\n"
                      "A conversion utility between these formats:\n"
                      "    *.h: Sipro #defines file\n"
                      "    *.pll: LogicLab3 library file\n"
@@ -148,18 +333,33 @@ class Arguments final
                      "\n";
        }
 
-    static void print_usage() noexcept
+    static void print_usage(std::ostream& os) noexcept
        {
-        std::cerr << "\nUsage (ver. " << __DATE__ << "):\n"
+        os << "\nUsage (ver. " << __DATE__ << "):\n"
                      "   llconv -fussy -verbose -options sort,schemaver:2.8 path/to/*.pll -output path/\n"
                      "       -clear (Delete existing files in output folder. Use with care!)\n"
+                     "       -files-from <path> (Read the input files from a list, '-' for stdin, or @<path>)\n"
+                     "       -from <pll|h> (Format of the standard input, passed as '-')\n"
                      "       -fussy (Handle issues as blocking errors)\n"
                      "       -help (Just print help info and abort)\n"
+                     "       -incremental (Skip the inputs unchanged since last run)\n"
+                     "       -io <buffered|mmap|writev|uring> (How outputs are written, default:buffered)\n"
+                     "       -jobs <num> (Convert files in parallel, 0 to use all cores)\n"
+                     "       -mux (Prefix each output with a '<name> <size>' line, for -output -)\n"
                      "       -options\n"
                      "            schema-ver:<num> (Indicate a schema version for LogicLab plclib output)\n"
                      "            sort:<str> (Objects sorting criteria default:by-name)\n"
-                     "       -output <path> (Set output directory or file)\n"
+                     "       -output <path> (Set output directory, a .pll or .plclib file to combine all, '-' for stdout)\n"
+                     "       -output-archive <path> (Write all the outputs and logs in a tar file)\n"
+                     "       -stats (Print the time spent in each phase)\n"
+                     "       -stats-json (Print the time spent in each phase as json)\n"
+                     "       -sync (Flush the written files to disk before exiting)\n"
+                     "       -trace <path> (Write a trace of the phases, see chrome://tracing)\n"
                      "       -verbose (Print more info on stdout)\n"
+                     "       -watch (Stay resident and convert again the modified files)\n"
+                     "       -write-if-changed (Don't touch the outputs whose content is unchanged)\n"
+                     "   llconv -server <socket> (Stay resident serving the clients)\n"
+                     "   llconv -client <socket> <arguments> (Let a server do the job)\n"
                      "\n";
        }
 
@@ -170,10 +370,45 @@ class Arguments final
     [[nodiscard]] bool fussy() const noexcept { return i_fussy; }
     [[nodiscard]] bool verbose() const noexcept { return i_verbose; }
     [[nodiscard]] bool clear() const noexcept { return i_clear; }
+    [[nodiscard]] std::size_t jobs() const noexcept { return i_jobs; }
+    [[nodiscard]] bool incremental() const noexcept { return i_incremental; }
+    [[nodiscard]] bool watch() const noexcept { return i_watch; }
+    [[nodiscard]] bool write_if_changed() const noexcept { return i_write_if_changed; }
+    [[nodiscard]] bool sync() const noexcept { return i_sync; }
+    [[nodiscard]] bool stats() const noexcept { return i_stats; }
+    [[nodiscard]] bool stats_json() const noexcept { return i_stats_json; }
+    [[nodiscard]] const fs::path& trace_path() const noexcept { return i_trace_path; }
+    [[nodiscard]] IO io() const noexcept { return i_io; }
+    [[nodiscard]] std::ostream* output_stream() const noexcept { return i_output_stream; }
+
+    //-----------------------------------------------------------------------
+    // The content of an input that's a member of an archive
+    [[nodiscard]] std::optional<std::string_view> archive_member(const fs::path& pth) const
+       {
+        if( i_members.empty() ) return std::nullopt;
+        const auto it = i_members.find(pth.string());
+        if( it==i_members.end() ) return std::nullopt;
+        return it->second;
+       }
+    [[nodiscard]] bool mux() const noexcept { return i_mux; }
+    [[nodiscard]] const fs::path& output_archive() const noexcept { return i_output_archive; }
+    [[nodiscard]] const fs::path& combined_output() const noexcept { return i_combined_output; }
+
+    //-----------------------------------------------------------------------
+    [[nodiscard]] static bool is_stdin(const fs::path& pth) noexcept { return pth.native()=="-"; }
+
+    //-----------------------------------------------------------------------
+    // The lowercase extension, or the declared format of the standard input
+    [[nodiscard]] std::string input_ext(const fs::path& pth) const
+       {
+        return is_stdin(pth) ? std::string(i_from) : str::tolower(pth.extension().string());
+       }
     [[nodiscard]] const str::keyvals& options() const noexcept { return i_options; }
+    [[nodiscard]] const std::vector<std::string>& issues() const noexcept { return i_issues; }
 
 
  private:
+    std::vector<fs::path> i_inputs; // As passed, possibly with wildcards
     std::vector<fs::path> i_files;
     inline static const fs::path i_default_output = ".";
     fs::path i_output = i_default_output;
@@ -182,18 +417,117 @@ class Arguments final
     bool i_verbose = false;
     bool i_clear = false;
     str::keyvals i_options; // Conversion and writing options
+    std::size_t i_jobs = 1; // Number of files converted concurrently
+    bool i_incremental = false; // Skip inputs already converted
+    bool i_watch = false; // Stay resident converting the modified inputs
+    bool i_write_if_changed = false; // Preserve the unchanged outputs
+    bool i_sync = false; // Ensure durability of the outputs
+    bool i_stats = false; // Print phases timing
+    bool i_stats_json = false; // Machine readable timing
+    fs::path i_trace_path; // Where to write the trace, if any
+    IO i_io = IO::buffered; // How the outputs are written
+    std::ostream* i_output_stream = nullptr; // If writing to standard output
+    bool i_mux = false; // Multiplex the outputs in the stream
+    fs::path i_output_archive; // Where to collect all the outputs, if any
+    fs::path i_combined_output; // The single file of all the libraries, if any
+    bool i_stdin_listed = false; // Standard input already used
+    std::string_view i_from; // Extension implied for the standard input
+    std::vector<std::unique_ptr<sys::MemoryMappedFile>> i_archives; // Mapped once for all their members
+    std::unordered_map<std::string,std::string_view> i_members; // 'archive.tar/member.h' → content
+    std::vector<std::string> i_issues; // Found collecting the inputs
+
+    //-----------------------------------------------------------------------
+    // The formats that can hold more libraries
+    [[nodiscard]] static bool is_combinable(const fs::path& pth)
+       {
+        const std::string ext{ str::tolower(pth.extension().string()) };
+        return ext==".pll"sv || ext==".plclib"sv;
+       }
+
+    //-----------------------------------------------------------------------
+    // The convertible files in a tar archive become inputs
+    // named 'archive.tar/member.h', parsed in place
+    void add_archive_members(const fs::path& archive_path)
+       {
+        const std::string archive_path_str{ archive_path.string() };
+        const auto& archive = *i_archives.emplace_back( std::make_unique<sys::MemoryMappedFile>(archive_path_str, true) );
+        for( auto& member : tar::list_files(archive.as_string_view()) )
+           {
+            const fs::path member_path{ member.name };
+            if( member_path.has_root_path() || std::ranges::any_of(member_path, [](const fs::path& part){ return part==".."; }) )
+               {// Would be outside the archive folder
+                i_issues.push_back( fmt::format("Skipped member {} of {}: unsafe path", member.name, archive_path_str) );
+                continue;
+               }
+            fs::path pth{ (archive_path / member_path).lexically_normal() };
+            const std::string ext{ str::tolower(pth.extension().string()) };
+            if( ext!=".pll"sv && ext!=".h"sv ) continue; // Not convertible
+            const auto [it, inserted] = i_members.try_emplace(pth.string(), member.content);
+            if( !inserted )
+               {// As extracting, the last one wins
+                i_issues.push_back( fmt::format("Duplicate member {} of {}, the last one is converted", member.name, archive_path_str) );
+                it->second = member.content;
+                continue;
+               }
+            i_files.push_back( std::move(pth) );
+           }
+       }
+
+    //-----------------------------------------------------------------------
+    // Read the input paths listed in a file (or stdin if "-"),
+    // one per line or separated by NUL characters
+    void add_inputs_from(const std::string_view list_path)
+       {
+        auto add_listed = [this](const std::string_view list) noexcept
+           {
+            const char sep = list.find('\0')!=std::string_view::npos ? '\0' : '\n';
+            std::size_t i_start = 0;
+            while( i_start<list.size() )
+               {
+                std::size_t i_end = list.find(sep, i_start);
+                if( i_end==std::string_view::npos ) i_end = list.size();
+                std::string_view item = list.substr(i_start, i_end-i_start);
+                if( sep=='\n' && item.ends_with('\r') ) item.remove_suffix(1);
+                if( !item.empty() ) i_inputs.emplace_back(item);
+                i_start = i_end + 1;
+               }
+           };
+
+        if( list_path=="-"sv )
+           {
+            const std::string list{ std::istreambuf_iterator<char>(std::cin), std::istreambuf_iterator<char>() };
+            add_listed(list);
+           }
+        else
+           {
+            const fs::path pth{ list_path };
+            std::error_code ec;
+            if( !fs::is_regular_file(pth, ec) )
+               {
+                throw std::invalid_argument(fmt::format("Files list not found: {}",list_path));
+               }
+            if( fs::file_size(pth, ec)>0 )
+               {
+                const sys::MemoryMappedFile buf(pth.string());
+                add_listed(buf.as_string_view());
+               }
+           }
+       }
 };
 
 
 
 //---------------------------------------------------------------------------
-// Clear generated files (log,pll,plclib) from output directory
-void clear_output_files(const Arguments& args, std::vector<std::string>& issues)
+// Clear generated files (log,pll,plclib) from output directory,
+// along the temporary ones left by an interrupted run (*.~pid-n)
+void clear_output_files(const Arguments& args, std::vector<std::string>& issues, std::ostream& out)
 {
-    const auto removed_count = sys::remove_files_inside(args.output(), std::regex{R"-(^.*\.(?:log|pll|plclib)$)-"});
+    static const std::regex generated_files_re{R"-(^.*\.(?:log|pll|plclib)(?:\.~[0-9]+-[0-9]+)?$)-"};
+    const stats::TraceSpan span("clear"sv);
+    const auto removed_count = sys::remove_files_inside(args.output(), generated_files_re);
     if( args.verbose() )
        {
-        std::cout << "Cleared " << removed_count << " files in " << args.output().string() << '\n';
+        out << "Cleared " << removed_count << " files in " << args.output().string() << '\n';
        }
 
     // Output directory should be normally empty (except dot files like ".gitignore")
@@ -214,18 +548,17 @@ void clear_output_files(const Arguments& args, std::vector<std::string>& issues)
 
 //---------------------------------------------------------------------------
 // Import a file
-template<typename F> void parse_buffer(F parsefunct, const std::string_view buf, const fs::path& pth, const std::string& str_pth, plcb::Library& lib, const Arguments& args, std::vector<std::string>& issues)
+// Note: the parsing issues are returned in 'parse_log' to be
+//       logged by the caller (see 'write_parse_log') when the
+//       conversion is reported, as any other side effect
+template<typename F> void parse_buffer(F parsefunct, const std::string_view buf, const std::string& str_pth, plcb::Library& lib, const Arguments& args, std::vector<std::string>& issues, std::vector<std::string>& parse_log, std::ostream& out, stats::FileStats* const st =nullptr)
 {
     std::vector<std::string> parse_issues;
-    try{
-        parsefunct(str_pth, buf, lib, parse_issues, args.fussy());
-       }
-    catch( parse_error& e)
        {
-        sys::edit_text_file( e.file_path(), e.pos() );
-        throw;
+        const stats::ScopedTimer timer(st, stats::Phase::parse);
+        parsefunct(str_pth, buf, lib, parse_issues, args.fussy());
        }
-    if(args.verbose()) std::cout << "    " << lib.to_str() << '\n';
+    if(args.verbose()) out << "    " << lib.to_str() << '\n';
 
     // Handle parsing issues
     if( !parse_issues.empty() )
@@ -233,22 +566,14 @@ template<typename F> void parse_buffer(F parsefunct, const std::string_view buf,
         // Append to overall issues list
         issues.push_back( fmt::format("____Parsing of {}",str_pth) );
         issues.insert(issues.end(), parse_issues.begin(), parse_issues.end());
-        // Log in a file
-        //const std::string log_file_path{ str::replace_extension(str_pth, ".log") }; // Same folder as input
-        //const std::string log_file_path{ (fs::temp_directory_path() / pth.filename()).replace_extension(".log").string() }; // Temporary folder
-        const std::string log_file_path{ (args.output() / pth.filename()).concat(".log").string() }; // In output folder
-        sys::file_write log_file_write( log_file_path );
-        log_file_write << sys::human_readable_time_stamp() << '\n';
-        log_file_write << "[Parse log of "sv << str_pth << "]\n"sv;
-        for(const std::string& issue : parse_issues)
-           {
-            log_file_write << "[!] "sv << issue << '\n';
-           }
-        sys::launch( log_file_path );
+        parse_log = std::move(parse_issues);
        }
 
     // Check the result
-    lib.check(); // throws if something's wrong
+       {
+        const stats::ScopedTimer timer(st, stats::Phase::check);
+        lib.check(); // throws if something's wrong
+       }
     if( lib.is_empty() )
         {
          issues.push_back( fmt::format("{} generated an empty library",str_pth) );
@@ -261,24 +586,187 @@ template<typename F> void parse_buffer(F parsefunct, const std::string_view buf,
     if( args.options().contains("sort")) // args.options().value_of("sort")=="name"
        {
         //if( args.verbose() ) std::cout << "Sorting lib " << lib.name() << '\n';
+        const stats::ScopedTimer timer(st, stats::Phase::sort);
         lib.sort();
        }
 
 }
 
 
+//---------------------------------------------------------------------------
+// Log the parsing issues of an input in a file
+void write_parse_log(const fs::path& pth, const std::string& str_pth, const std::vector<std::string>& parse_issues, const Arguments& args)
+{
+    //const std::string log_file_path{ str::replace_extension(str_pth, ".log") }; // Same folder as input
+    //const std::string log_file_path{ (fs::temp_directory_path() / pth.filename()).replace_extension(".log").string() }; // Temporary folder
+    const std::string log_file_path{ (args.output() / pth.filename()).concat(".log").string() }; // In output folder
+    const stats::TraceSpan span("write-log"sv, log_file_path);
+    auto write_log = [&str_pth, &parse_issues](auto& f)
+       {
+        f << sys::human_readable_time_stamp() << '\n';
+        f << "[Parse log of "sv << str_pth << "]\n"sv;
+        for(const std::string& issue : parse_issues)
+           {
+            f << "[!] "sv << issue << '\n';
+           }
+       };
+    if( tar::output )
+       {// Along the other outputs
+        sys::string_write log_write;
+        write_log(log_write);
+        tar::output->add(fs::path(log_file_path).filename().string(), log_write.view());
+       }
+    else
+       {
+        sys::file_write log_file_write( log_file_path );
+        write_log(log_file_write);
+        log_file_write.close();
+        sys::launch( log_file_path );
+       }
+}
+
+
+//---------------------------------------------------------------------------
+// Tell if two generated contents are the same except for the time stamp
+[[nodiscard]] bool equal_but_time_stamp(const std::string_view a, const std::string_view b) noexcept
+{
+    if( a.size()!=b.size() ) return false;
+    const auto i_diff = static_cast<std::size_t>(std::mismatch(a.begin(), a.end(), b.begin()).first - a.begin());
+    if( i_diff==a.size() ) return true;
+
+    // The first difference must fall in a time stamp like "2022-01-31 23:59:59"
+    constexpr std::string_view stamp_mask = "0000-00-00 00:00:00"sv;
+    auto is_stamp = [stamp_mask](const std::string_view s) noexcept
+       {
+        for( std::size_t i=0; i<stamp_mask.size(); ++i )
+           {
+            if( stamp_mask[i]=='0' ? (s[i]<'0' || s[i]>'9') : s[i]!=stamp_mask[i] ) return false;
+           }
+        return true;
+       };
+    const std::size_t i_first = i_diff>=stamp_mask.size() ? i_diff-stamp_mask.size()+1 : 0;
+    for( std::size_t i=i_first; i<=i_diff && i+stamp_mask.size()<=a.size(); ++i )
+       {
+        if( is_stamp(a.substr(i, stamp_mask.size())) && is_stamp(b.substr(i, stamp_mask.size())) )
+           {// Then the rest must be equal
+            return a.substr(i+stamp_mask.size()) == b.substr(i+stamp_mask.size());
+           }
+       }
+    return false;
+}
+
+
+//---------------------------------------------------------------------------
+// Write a generated content, unless the file has already got it
+void write_if_changed(const std::string_view content, const std::string& pth, const Arguments& args, std::ostream& out)
+{
+    std::error_code ec;
+    const std::uintmax_t old_siz = fs::file_size(pth, ec);
+    if( !ec && old_siz==content.size() && old_siz>0 )
+       {
+        const sys::MemoryMappedFile old_content(pth, true); // Compared entirely
+        if( equal_but_time_stamp(old_content.as_string_view(), content) )
+           {
+            if( args.verbose() ) out << "    " "Unchanged, not overwritten\n";
+            return;
+           }
+       }
+    sys::file_write out_file_write(pth);
+    out_file_write << content;
+    out_file_write.close();
+}
+
+
+//---------------------------------------------------------------------------
+// Write a generated content in the standard output, possibly shared
+// with other outputs: if multiplexed each one is prefixed by a line
+// with its name and size in bytes
+void write_to_stream(const std::string_view name, const std::string_view content, const Arguments& args)
+{
+    static std::mutex mtx; // Outputs may come from more threads
+    const std::scoped_lock lock(mtx);
+    std::ostream& os = *args.output_stream();
+    if( args.mux() ) os << name << ' ' << content.size() << '\n';
+    os.write(content.data(), static_cast<std::streamsize>(content.size()));
+    sys::thread_write_counters().bytes += content.size();
+}
+
+
+//---------------------------------------------------------------------------
+// Write a generated output with the chosen method
+template<typename F> void write_output(F write_content, const std::string& pth, const Arguments& args, std::ostream& out)
+{
+    if( args.output_stream() )
+       {
+        sys::string_write generated;
+        write_content(generated);
+        write_to_stream(fs::path(pth).filename().string(), generated.view(), args);
+       }
+    else if( tar::output )
+       {
+        sys::string_write generated;
+        write_content(generated);
+        tar::output->add(fs::path(pth).filename().string(), generated.view());
+       }
+    else if( args.write_if_changed() )
+       {
+        sys::string_write generated;
+        write_content(generated);
+        write_if_changed(generated.view(), pth, args, out);
+       }
+    else if( args.io()==Arguments::IO::mmap )
+       {// Exact size first, then fill the mapped file
+        sys::count_write counted;
+        write_content(counted);
+        sys::mapped_file_write out_file_write(pth, counted.size());
+        write_content(out_file_write);
+        out_file_write.close();
+       }
+    else if( args.io()==Arguments::IO::uring && aio::outputs )
+       {// Written later, along with the others
+        sys::string_write generated;
+        write_content(generated);
+        aio::outputs->add(pth, generated.take());
+       }
+    else if( args.io()==Arguments::IO::writev )
+       {
+        sys::gather_write out_file_write(pth);
+        write_content(out_file_write);
+        out_file_write.close();
+       }
+    else
+       {
+        sys::file_write out_file_write(pth);
+        write_content(out_file_write);
+        out_file_write.close();
+       }
+}
+
+
+//---------------------------------------------------------------------------
+// Wait the batched writes, if any
+void finish_writes(std::vector<std::string>& issues)
+{
+    if( !aio::outputs ) return;
+    const stats::TraceSpan span("finish-writes"sv);
+    for( const auto& pth : aio::outputs->finish() )
+       {
+        issues.push_back( fmt::format("Cannot write to: {}", pth) );
+       }
+}
+
+
 //---------------------------------------------------------------------------
 // Write PLC library to plclib format
-void write_plclib(const plcb::Library& lib, const std::string& pth, const Arguments& args)
+void write_plclib(const plcb::Library& lib, const std::string& pth, const Arguments& args, std::ostream& out)
 {
     //if( args.output_isdir() )
     //   {
         if( args.verbose() )
            {
-            std::cout << "    " "Writing to: "  << pth << '\n';
+            out << "    " "Writing to: "  << pth << '\n';
            }
-        sys::file_write out_file_write(pth);
-        plclib::write(out_file_write, lib, args.options());
+        write_output([&lib, &args](auto& f){ plclib::write(f, lib, args.options()); }, pth, args, out);
     //   }
     //else
     //   {// Combine in a single 'plcprj' file
@@ -289,16 +777,15 @@ void write_plclib(const plcb::Library& lib, const std::string& pth, const Argume
 
 //---------------------------------------------------------------------------
 // Write PLC library to pll format
-void write_pll(const plcb::Library& lib, const std::string& pth, const Arguments& args)
+void write_pll(const plcb::Library& lib, const std::string& pth, const Arguments& args, std::ostream& out)
 {
     //if( args.output_isdir() )
     //   {
         if( args.verbose() )
            {
-            std::cout << "    " "Writing to: "  << pth << '\n';
+            out << "    " "Writing to: "  << pth << '\n';
            }
-        sys::file_write out_file_write(pth);
-        pll::write(out_file_write, lib, args.options());
+        write_output([&lib, &args](auto& f){ pll::write(f, lib, args.options()); }, pth, args, out);
     //   }
     //else
     //   {// Combine in a single 'pll' file
@@ -308,123 +795,830 @@ void write_pll(const plcb::Library& lib, const std::string& pth, const Arguments
 
 
 
+
+/////////////////////////////////////////////////////////////////////////////
+// All the libraries combined in a single output file, each one
+// rendered by any thread as soon as converted, so it can be
+// released right after, and appended in the order of the inputs:
+// the ones converted ahead wait their turn in memory.
+// While existing, it's reachable through 'combined_output'
+class CombinedOutput;
+inline CombinedOutput* combined_output = nullptr; // Not null when combining
+
+class CombinedOutput final
+{
+ public:
+    explicit CombinedOutput(const Arguments& args)
+      : i_options(args.options())
+       {
+        const std::string pth{ args.combined_output().string() };
+        if( str::tolower(args.combined_output().extension().string())==".pll"sv ) i_pll.emplace(pth);
+        else i_plclib.emplace(pth);
+        combined_output = this;
+       }
+
+    ~CombinedOutput() noexcept
+       {
+        combined_output = nullptr;
+       }
+
+    CombinedOutput(const CombinedOutput&) = delete;
+    CombinedOutput(CombinedOutput&&) = delete;
+    CombinedOutput& operator=(const CombinedOutput&) = delete;
+    CombinedOutput& operator=(CombinedOutput&&) = delete;
+
+    [[nodiscard]] stats::Phase phase() const noexcept { return i_pll ? stats::Phase::write_pll : stats::Phase::write_plclib; }
+
+    //-----------------------------------------------------------------------
+    // The library of the input of index 'idx', can be called by any thread
+    void add(const std::size_t idx, const plcb::Library& lib)
+       {
+        Pending pend{ lib.name(), names_of(lib), {}, {} };
+        if( i_pll ) pend.pll_part = pll::CombinedWriter::render(lib);
+        else pend.plclib_part = plclib::CombinedWriter::render(lib);
+
+        const std::scoped_lock lock(i_mtx);
+        i_pending.try_emplace(idx, std::move(pend));
+        append_ready();
+       }
+
+    //-----------------------------------------------------------------------
+    // The input of index 'idx' has no library to add
+    void skip(const std::size_t idx)
+       {
+        const std::scoped_lock lock(i_mtx);
+        i_pending.try_emplace(idx, std::nullopt);
+        append_ready();
+       }
+
+    //-----------------------------------------------------------------------
+    // Append what's left, the name clashes are moved in 'issues'
+    void close(std::vector<std::string>& issues)
+       {
+        const std::scoped_lock lock(i_mtx);
+        for( auto& [idx, pend] : i_pending )
+           {
+            if( pend ) append(*pend);
+           }
+        i_pending.clear();
+        issues.insert(issues.end(), std::make_move_iterator(i_issues.begin()), std::make_move_iterator(i_issues.end()));
+        i_issues.clear();
+        if( i_pll ) i_pll->close();
+        else i_plclib->close(i_options);
+       }
+
+ private:
+    struct Pending
+       {
+        std::string lib_name;
+        std::vector<std::string> names; // Of the library elements
+        std::string pll_part;
+        plclib::CombinedWriter::Part plclib_part;
+       };
+
+    const str::keyvals& i_options;
+    std::optional<pll::CombinedWriter> i_pll;
+    std::optional<plclib::CombinedWriter> i_plclib;
+    std::unordered_map<std::string,std::string> i_names; // Element name → library
+    std::map<std::size_t,std::optional<Pending>> i_pending; // Input index → library to append (if any)
+    std::size_t i_next = 0; // Index of the input to append next
+    std::vector<std::string> i_issues; // The name clashes
+    std::mutex i_mtx;
+
+    //-----------------------------------------------------------------------
+    // Append the libraries whose previous inputs are done
+    void append_ready()
+       {
+        for( auto it=i_pending.begin(); it!=i_pending.end() && it->first==i_next; it=i_pending.erase(it), ++i_next )
+           {
+            if( it->second ) append(*it->second);
+           }
+       }
+
+    //-----------------------------------------------------------------------
+    void append(const Pending& pend)
+       {
+        check_names(pend);
+        if( i_pll ) i_pll->add(pend.pll_part);
+        else i_plclib->add(pend.plclib_part);
+       }
+
+    //-----------------------------------------------------------------------
+    // Elements with the same name would clash in the combined library
+    void check_names(const Pending& pend)
+       {
+        for( const auto& name : pend.names )
+           {
+            const auto [it, inserted] = i_names.try_emplace(name, pend.lib_name);
+            if( !inserted ) i_issues.push_back( fmt::format("{} of {} already defined in {}"sv, name, pend.lib_name, it->second) );
+           }
+       }
+
+    //-----------------------------------------------------------------------
+    // The names of the library elements
+    [[nodiscard]] static std::vector<std::string> names_of(const plcb::Library& lib)
+       {
+        std::vector<std::string> names;
+        auto add = [&names](const std::string_view name)
+           {
+            names.emplace_back(name);
+           };
+        for( const auto* vars : {&lib.global_constants(), &lib.global_retainvars(), &lib.global_variables()} )
+           {
+            for( const auto& group : vars->groups() )
+               {
+                for( const auto& var : group.variables() ) add(var.name());
+               }
+           }
+        for( const auto& pou : lib.functions() ) add(pou.name());
+        for( const auto& pou : lib.function_blocks() ) add(pou.name());
+        for( const auto& pou : lib.programs() ) add(pou.name());
+        for( const auto& macro : lib.macros() ) add(macro.name());
+        for( const auto& strct : lib.structs() ) add(strct.name());
+        for( const auto& tdef : lib.typedefs() ) add(tdef.name());
+        for( const auto& en : lib.enums() ) add(en.name());
+        for( const auto& subr : lib.subranges() ) add(subr.name());
+        return names;
+       }
+};
+
 #ifdef PLL_TEST
 //---------------------------------------------------------------------------
 // Una funzione di test
-void test_pll(const std::string& fbasename, const plcb::Library& lib, const Arguments& args, std::vector<std::string>& issues)
+void test_pll(const std::string& fbasename, const plcb::Library& lib, const Arguments& args, std::vector<std::string>& issues, std::ostream& out)
 {
     // Riscrivo come pll la libreria in ingresso...
     const fs::path out_pll_pth{ args.output() / fmt::format("{}-1.pll", fbasename) };
     const std::string out_pll_pth_str{ out_pll_pth.string() };
-    write_pll(lib, out_pll_pth_str, args);
+    write_pll(lib, out_pll_pth_str, args, out);
     // ...Lo rileggo generando una nuova libreria...
     const sys::MemoryMappedFile buf2(out_pll_pth_str);
     plcb::Library lib2( out_pll_pth.stem().string() );
-    parse_buffer(pll::parse, buf2.as_string_view(), out_pll_pth, out_pll_pth_str, lib2, args, issues);
+    std::vector<std::string> parse_log;
+    parse_buffer(pll::parse, buf2.as_string_view(), out_pll_pth_str, lib2, args, issues, parse_log, out);
+    if( !parse_log.empty() ) write_parse_log(out_pll_pth, out_pll_pth_str, parse_log, args);
     // ...E la scrivo di nuovo
     const fs::path out_pll2_pth{ args.output() / fmt::format("{}-2.pll", fbasename) };
-    write_pll(lib2, out_pll2_pth.string(), args);
+    write_pll(lib2, out_pll2_pth.string(), args, out);
 }
 #endif
 
 
 
-//---------------------------------------------------------------------------
-int main( const int argc, const char* const argv[] )
+/////////////////////////////////////////////////////////////////////////////
+// An input file along its conversion, collecting its own report
+class FileConversion final
 {
-    std::ios_base::sync_with_stdio(false); // Better performance
+ public:
+    FileConversion(const std::size_t idx, const Arguments& args)
+      : i_index(idx)
+      , i_path(args.files()[idx])
+      , i_fullpath(i_path.string())
+      , i_basename(Arguments::is_stdin(i_path) ? "stdin"s : i_path.stem().string())
+      , i_ext(args.input_ext(i_path))
+       {
+        i_stats.name = i_path.filename().string();
+       }
 
-    try{
-        Arguments args(argc, argv); // std::span(argv, argc)
-        std::vector<std::string> issues;
+    FileConversion(const FileConversion&) = delete;
+    FileConversion(FileConversion&&) = delete;
+    FileConversion& operator=(const FileConversion&) = delete;
+    FileConversion& operator=(FileConversion&&) = delete;
 
-        if( args.verbose() )
+    [[nodiscard]] const fs::path& path() const noexcept { return i_path; }
+    [[nodiscard]] const std::string& fullpath() const noexcept { return i_fullpath; }
+    [[nodiscard]] const std::string& basename() const noexcept { return i_basename; }
+    [[nodiscard]] const std::string& ext() const noexcept { return i_ext; }
+
+    [[nodiscard]] std::ostream& out() noexcept { return i_out; }
+    [[nodiscard]] std::vector<std::string>& issues() noexcept { return i_issues; }
+    [[nodiscard]] bool failed() const noexcept { return static_cast<bool>(i_error); }
+    void set_error(std::exception_ptr e) noexcept { i_error = e; }
+
+    //-----------------------------------------------------------------------
+    [[nodiscard]] fs::path output_path(const Arguments& args, const std::string_view ext) const
+       {
+        return args.output() / fmt::format("{}{}", i_basename, ext);
+       }
+
+    //-----------------------------------------------------------------------
+    // Prepare the file buffer
+    // Note: Extension not recognized is an exceptional case,
+    //       so there's nor arm to confidently open the file
+    void map(const Arguments& args, const build::Manifest* const manifest =nullptr)
+       {
+        const stats::ScopedTimer timer(timing(args), stats::Phase::map);
+        if( const auto member = args.archive_member(i_path) ) i_content = *member; // Already mapped
+        else
            {
-            std::cout << "---- llconv (ver. " << __DATE__ << ") ----\n";
-            std::cout << "Running in: " << fs::current_path().string() << '\n';
+            if( Arguments::is_stdin(i_path) ) i_buf.emplace(sys::MemoryMappedFile::standard_input);
+            else i_buf.emplace(i_fullpath);
+            i_content = i_buf->as_string_view();
            }
+        i_stats.bytes = i_content.size();
 
-        if( args.files().empty() )
+        // Show file name and size
+        if( args.verbose() )
            {
-            throw std::invalid_argument("No files passed");
+            i_out << "\nProcessing " << i_fullpath;
+            i_out << " (size: ";
+            if(i_content.size()>1048576) i_out << i_content.size()/1048576 << "MB)\n";
+            else if(i_content.size()>1024) i_out << i_content.size()/1024 << "KB)\n";
+            else i_out << i_content.size() << "B)\n";
            }
 
-        if( args.clear() && args.output_isdir() )
+        // Skip if already converted
+        if( manifest && !Arguments::is_stdin(i_path) )
            {
-            if( args.output_isdefault() )
+            i_manifest_key = fs::absolute(i_path).lexically_normal().string();
+            i_hash = str::hash64( i_content );
+            if( manifest->is_unchanged(i_manifest_key, i_hash) && outputs_exist(args) )
                {
-                issues.push_back("Won't clear files in default output folder");
+                if( args.verbose() ) i_out << "    Unchanged, skipped\n";
+                i_buf.reset();
+                i_content = {};
+                return;
+               }
+           }
+
+        i_lib.emplace( i_basename ); // This will refer to 'i_content'!
+       }
+
+    //-----------------------------------------------------------------------
+    // Touch the mapped pages, so parsing won't stall on disk
+    void prefetch(const Arguments& args) noexcept
+       {
+        const stats::ScopedTimer timer(timing(args), stats::Phase::map);
+        if( i_buf ) i_buf->prefetch();
+       }
+
+    //-----------------------------------------------------------------------
+    // Recognize by file extension
+    void parse(const Arguments& args)
+       {
+        if( !i_lib ) return; // Skipped
+
+        if( i_ext == ".pll" )
+           {// pll -> plclib
+            parse_buffer(pll::parse, i_content, i_fullpath, *i_lib, args, i_issues, i_parse_log, i_out, timing(args));
+           }
+        else if( i_ext == ".h" )
+           {// h -> pll,plclib
+            parse_buffer(h::parse, i_content, i_fullpath, *i_lib, args, i_issues, i_parse_log, i_out, timing(args));
+           }
+        else
+           {
+            const std::string msg{ fmt::format("Unhandled extension {} of {}"sv, i_ext, i_path.filename().string()) };
+            if( args.fussy() )
+               {
+                throw std::runtime_error(msg);
                }
             else
                {
-                clear_output_files(args, issues);
+                i_issues.push_back(msg);
                }
+            i_lib.reset(); // Nothing to write
            }
+       }
 
-        for( const auto& file_path_obj : args.files() )
-           {
-            // Prepare the file buffer
-            // Note: Extension not recognized is an exceptional case,
-            //       so there's nor arm to confidently open the file
-            const std::string file_fullpath{ file_path_obj.string() };
-            const sys::MemoryMappedFile file_buf(file_fullpath); // Do not deallocate until the very end!
+    //-----------------------------------------------------------------------
+    void write(const Arguments& args)
+       {
+        if( !i_lib )
+           {// Nothing to write
+            if( combined_output ) combined_output->skip(i_index);
+            return;
+           }
+        i_stats.elements = i_lib->elements_count();
+        const auto counters_before = sys::thread_write_counters();
 
-            // Show file name and size
+        if( combined_output )
+           {// Appended to the single output
             if( args.verbose() )
                {
-                std::cout << "\nProcessing " << file_fullpath;
-                std::cout << " (size: ";
-                if(file_buf.size()>1048576) std::cout << file_buf.size()/1048576 << "MB)\n";
-                else if(file_buf.size()>1024) std::cout << file_buf.size()/1024 << "KB)\n";
-                else std::cout << file_buf.size() << "B)\n";
-               }
-
-            const std::string file_basename{ file_path_obj.stem().string() };
-            plcb::Library lib( file_basename ); // This will refer to 'file_buf'!
-
-            // Recognize by file extension
-            const std::string file_ext{ str::tolower(file_path_obj.extension().string()) };
-            if( file_ext == ".pll" )
-               {// pll -> plclib
-                parse_buffer(pll::parse, file_buf.as_string_view(), file_path_obj, file_fullpath, lib, args, issues);
-              #ifdef PLL_TEST
-                test_pll(file_basename, lib, args, issues);
-              #else
-                const fs::path out_plclib_pth{ args.output() / fmt::format("{}.plclib", file_basename) };
-                write_plclib(lib, out_plclib_pth.string(), args);
-              #endif
-               }
-            else if( file_ext == ".h" )
-               {// h -> pll,plclib
-                parse_buffer(h::parse, file_buf.as_string_view(), file_path_obj, file_fullpath, lib, args, issues);
-
-                const fs::path out_pll_pth{ args.output() / fmt::format("{}.pll", file_basename) };
-                write_pll(lib, out_pll_pth.string(), args);
-
-                const fs::path out_plclib_pth{ args.output() / fmt::format("{}.plclib", file_basename) };
-                write_plclib(lib, out_plclib_pth.string(), args);
+                i_out << "    " "Appending to: "  << args.combined_output().string() << '\n';
                }
-            else
+            const stats::ScopedTimer timer(timing(args), combined_output->phase());
+            combined_output->add(i_index, *i_lib);
+           }
+        else if( i_ext == ".pll" )
+           {// pll -> plclib
+          #ifdef PLL_TEST
+            test_pll(i_basename, *i_lib, args, i_issues, i_out);
+          #else
+            const stats::ScopedTimer timer(timing(args), stats::Phase::write_plclib);
+            write_plclib(*i_lib, output_path(args, ".plclib"sv).string(), args, i_out);
+          #endif
+           }
+        else if( i_ext == ".h" )
+           {// h -> pll,plclib
                {
-                const std::string msg{ fmt::format("Unhandled extension {} of {}"sv, file_ext, file_path_obj.filename().string()) };
-                if( args.fussy() )
+                const stats::ScopedTimer timer(timing(args), stats::Phase::write_pll);
+                write_pll(*i_lib, output_path(args, ".pll"sv).string(), args, i_out);
+               }
+            const stats::ScopedTimer timer(timing(args), stats::Phase::write_plclib);
+            write_plclib(*i_lib, output_path(args, ".plclib"sv).string(), args, i_out);
+           }
+
+        const auto counters_after = sys::thread_write_counters();
+        i_stats.written_bytes += counters_after.bytes - counters_before.bytes;
+        i_stats.flushes += counters_after.flushes - counters_before.flushes;
+       }
+
+    //-----------------------------------------------------------------------
+    // Record the outcome in the manifest: just the inputs
+    // converted without issues can be skipped next time
+    void update(build::Manifest& manifest) const
+       {
+        if( i_manifest_key.empty() ) return; // Not even mapped
+        if( !i_error && i_issues.empty() ) manifest.set(i_manifest_key, i_hash);
+        else manifest.remove(i_manifest_key);
+       }
+
+    //-----------------------------------------------------------------------
+    // Free the resources once written
+    void release() noexcept
+       {
+        i_lib.reset();
+        i_content = {};
+        i_buf.reset();
+       }
+
+    //-----------------------------------------------------------------------
+    // Print the collected output and gather the issues and stats,
+    // rethrowing the possible error. The side effects besides the
+    // outputs (log file, editor) happen here, so nothing is done
+    // for the inputs following a failed one
+    void report(const Arguments& args, std::ostream& os, std::vector<std::string>& issues, std::vector<stats::FileStats>* const files_stats)
+       {
+        if( !i_parse_log.empty() )
+           {
+            try{
+                write_parse_log(i_path, i_fullpath, i_parse_log, args);
+               }
+            catch(...)
+               {
+                if( !i_error ) i_error = std::current_exception();
+               }
+            i_parse_log.clear();
+           }
+        os << i_out.view();
+        if( files_stats ) files_stats->push_back( std::move(i_stats) );
+        issues.insert(issues.end(), std::make_move_iterator(i_issues.begin()), std::make_move_iterator(i_issues.end()));
+        i_issues.clear();
+        if( i_error )
+           {
+            try{
+                std::rethrow_exception(i_error);
+               }
+            catch( parse_error& e )
+               {
+                sys::edit_text_file( e.file_path(), e.pos() );
+                throw;
+               }
+           }
+       }
+
+ private:
+    const std::size_t i_index; // In the input files
+    const fs::path& i_path;
+    const std::string i_fullpath;
+    const std::string i_basename;
+    const std::string i_ext;
+    std::optional<sys::MemoryMappedFile> i_buf; // Do not deallocate until written!
+    std::string_view i_content; // In 'i_buf' or in an archive
+    std::optional<plcb::Library> i_lib; // Refers to 'i_content'
+    std::ostringstream i_out;
+    std::vector<std::string> i_issues;
+    std::vector<std::string> i_parse_log; // Parsing issues to be logged
+    std::exception_ptr i_error;
+    std::string i_manifest_key; // Set when incremental
+    std::uint64_t i_hash = 0; // Content hash
+    stats::FileStats i_stats;
+
+    //-----------------------------------------------------------------------
+    [[nodiscard]] stats::FileStats* timing(const Arguments& args) noexcept
+       {
+        return args.stats() || stats::tracer ? &i_stats : nullptr;
+       }
+
+    //-----------------------------------------------------------------------
+    [[nodiscard]] bool outputs_exist(const Arguments& args) const
+       {
+        if( args.output_stream() || !args.output_archive().empty() ) return false; // Must be written again
+        std::error_code ec;
+        if( i_ext == ".pll" ) return fs::exists(output_path(args, ".plclib"sv), ec);
+        else if( i_ext == ".h" ) return fs::exists(output_path(args, ".pll"sv), ec) && fs::exists(output_path(args, ".plclib"sv), ec);
+        return false;
+       }
+};
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Hints the system to read the next inputs in background, a few
+// files ahead of the one being converted, so mapping them won't
+// stall on cold caches or network filesystems
+class InputsReadAhead final
+{
+ public:
+    static constexpr std::size_t ahead_count = 4; // Files
+
+    InputsReadAhead(const std::vector<fs::path>& files, const std::vector<std::size_t>& order)
+      : i_files(files)
+      , i_order(order) {}
+
+    //-----------------------------------------------------------------------
+    // Starting the n-th input (in the order), can be called by any thread
+    void starting(const std::size_t n) noexcept
+       {
+        const std::scoped_lock lock(i_mtx);
+        const std::size_t i_end = std::min(n + 1 + ahead_count, i_order.size());
+        for( i_next=std::max(i_next, n+1); i_next<i_end; ++i_next )
+           {
+            const fs::path& pth = i_files[i_order[i_next]];
+            if( !Arguments::is_stdin(pth) ) sys::advise_will_read(pth);
+           }
+       }
+
+ private:
+    const std::vector<fs::path>& i_files;
+    const std::vector<std::size_t>& i_order;
+    std::size_t i_next = 0; // Next to be hinted
+    std::mutex i_mtx;
+};
+
+
+//---------------------------------------------------------------------------
+// Convert a single input file
+void convert_file(const std::size_t idx, const Arguments& args, build::Manifest* const manifest, std::vector<std::string>& issues, std::vector<stats::FileStats>* const files_stats, std::ostream& out)
+{
+    FileConversion conv(idx, args);
+    try{
+        conv.map(args, manifest);
+        conv.parse(args);
+        conv.write(args);
+       }
+    catch(...)
+       {
+        conv.set_error( std::current_exception() );
+       }
+    if( manifest ) conv.update(*manifest);
+    conv.report(args, out, issues, files_stats);
+}
+
+
+//---------------------------------------------------------------------------
+// Convert the input files one at a time
+void convert_files_sequential(const Arguments& args, build::Manifest* const manifest, std::vector<std::string>& issues, std::vector<stats::FileStats>* const files_stats, std::ostream& out)
+{
+    for( std::size_t k=0; k<args.files().size(); ++k )
+       {
+        convert_file(k, args, manifest, issues, files_stats, out);
+       }
+}
+
+
+//---------------------------------------------------------------------------
+// Convert the input files in a three stages pipeline:
+// [map and prefetch] → [parse] → [write]
+// so that parsing of a file overlaps with writing of the
+// previous one and with the reading of the following ones
+void convert_files_pipelined(const Arguments& args, build::Manifest* const manifest, std::vector<std::string>& issues, std::vector<stats::FileStats>* const files_stats, std::ostream& out)
+{
+    using conv_ptr = std::unique_ptr<FileConversion>;
+    mt::BoundedQueue<conv_ptr> mapped(4);
+    mt::BoundedQueue<conv_ptr> parsed(2);
+
+    std::vector<std::size_t> in_order(args.files().size());
+    std::iota(in_order.begin(), in_order.end(), 0u);
+    InputsReadAhead read_ahead(args.files(), in_order);
+
+    std::thread mapper([&args, manifest, &mapped, &read_ahead]
+       {
+        for( std::size_t k=0; k<args.files().size(); ++k )
+           {
+            read_ahead.starting(k);
+            auto conv = std::make_unique<FileConversion>(k, args);
+            try{
+                conv->map(args, manifest);
+                conv->prefetch(args);
+               }
+            catch(...)
+               {
+                conv->set_error( std::current_exception() );
+               }
+            if( !mapped.push(std::move(conv)) ) break;
+           }
+        mapped.close();
+       });
+
+    std::thread parser([&args, &mapped, &parsed]
+       {
+        while( auto conv = mapped.pop() )
+           {
+            if( !(*conv)->failed() )
+               {
+                try{
+                    (*conv)->parse(args);
+                   }
+                catch(...)
                    {
-                    throw std::runtime_error(msg);
+                    (*conv)->set_error( std::current_exception() );
+                   }
+               }
+            const bool failed = (*conv)->failed();
+            if( !parsed.push(std::move(*conv)) || failed )
+               {// Nothing after a failed input
+                mapped.cancel();
+                break;
+               }
+           }
+        parsed.close();
+       });
+
+    // Write in this thread, stop at the first error: the inputs
+    // already parsed ahead are discarded without side effects
+    try{
+        while( auto conv = parsed.pop() )
+           {
+            if( !(*conv)->failed() )
+               {
+                try{
+                    (*conv)->write(args);
                    }
-                else
+                catch(...)
                    {
-                    issues.push_back(msg);
+                    (*conv)->set_error( std::current_exception() );
                    }
                }
+            (*conv)->release();
+            if( manifest ) (*conv)->update(*manifest);
+            (*conv)->report(args, out, issues, files_stats);
            }
+       }
+    catch(...)
+       {
+        mapped.cancel();
+        parsed.cancel();
+        mapper.join();
+        parser.join();
+        throw;
+       }
+    mapper.join();
+    parser.join();
+}
 
-        if( issues.size()>0 )
+
+//---------------------------------------------------------------------------
+// Convert the input files concurrently, biggest first.
+// Each file collects its own output and issues, that are
+// reported in the same order of the input files
+void convert_files_parallel(const Arguments& args, build::Manifest* const manifest, std::vector<std::string>& issues, std::vector<stats::FileStats>* const files_stats, std::ostream& out)
+{
+    const auto& files = args.files();
+    std::vector<std::uintmax_t> sizes(files.size(), 0u);
+    std::vector<std::unique_ptr<FileConversion>> convs;
+    convs.reserve(files.size());
+    for( std::size_t k=0; k<files.size(); ++k )
+       {
+        convs.push_back( std::make_unique<FileConversion>(k, args) );
+        if( combined_output ) continue; // Same weight, started in input order to be appended soon
+        std::error_code ec;
+        if( const auto member = args.archive_member(files[k]) ) sizes[k] = member->size();
+        else if( const std::uintmax_t siz = fs::file_size(files[k], ec); !ec ) sizes[k] = siz;
+       }
+
+    // Best effort to stop as the sequential case would: the inputs
+    // after the first failed one (in input order) aren't started nor
+    // written if the failure is already known, but an input can
+    // fail when a following one has already written its outputs
+    std::atomic<std::size_t> first_failed{files.size()};
+    auto is_after_failure = [&first_failed](const std::size_t k) noexcept { return k>first_failed.load(); };
+    auto set_failed = [&first_failed](const std::size_t k) noexcept
+       {
+        std::size_t prev = first_failed.load();
+        while( k<prev && !first_failed.compare_exchange_weak(prev, k) ) {}
+       };
+
+    mt::LargestFirstPool pool(sizes, args.jobs());
+    InputsReadAhead read_ahead(files, pool.order());
+    std::atomic<std::size_t> started{0};
+    pool.run([&args, manifest, &convs, &read_ahead, &started, &is_after_failure, &set_failed](const std::size_t k)
+       {
+        read_ahead.starting(started++);
+        if( is_after_failure(k) ) return; // Won't be reported
+        FileConversion& conv = *convs[k];
+        try{
+            conv.map(args, manifest);
+            conv.parse(args);
+            if( !is_after_failure(k) ) conv.write(args);
+           }
+        catch(...)
            {
-            std::cerr << "[!] " << issues.size() << " issues found\n";
-            for( const auto& issue : issues )
+            conv.set_error( std::current_exception() );
+            set_failed(k);
+           }
+        conv.release();
+       });
+
+    // Report in input order, stop at the first error as sequential would do
+    for( auto& conv : convs )
+       {
+        if( manifest ) conv->update(*manifest);
+        conv->report(args, out, issues, files_stats);
+       }
+}
+
+
+//---------------------------------------------------------------------------
+// Print and forget the collected issues
+void print_issues(std::vector<std::string>& issues, std::ostream& err)
+{
+    if( issues.size()>0 )
+       {
+        err << "[!] " << issues.size() << " issues found\n";
+        for( const auto& issue : issues )
+           {
+            err << "    " << issue << '\n';
+           }
+        issues.clear();
+       }
+}
+
+
+//---------------------------------------------------------------------------
+// Stay resident converting again the input files as they're written
+[[noreturn]] void watch_files(sys::FilesWatcher& watcher, const Arguments& args, build::Manifest* const manifest, const fs::path& manifest_path, std::ostream& out, std::ostream& err)
+{
+    out << "Watching " << args.files().size() << " files, press Ctrl+C to quit" << std::endl;
+    std::vector<std::string> issues;
+    while( true )
+       {
+        for( const std::size_t idx : watcher.wait_changes(100) )
+           {
+            const fs::path& file_path_obj = args.files()[idx];
+            out << sys::human_readable_time_stamp() << " Converting " << file_path_obj.string() << '\n';
+            try{
+                convert_file(idx, args, manifest, issues, nullptr, out);
+               }
+            catch( std::exception& e )
+               {// Keep watching
+                out << std::flush;
+                err << "!! Error: " << e.what() << '\n';
+               }
+           }
+        finish_writes(issues);
+        if( manifest ) manifest->save(manifest_path);
+        if( args.sync() ) sys::sync_filesystem(args.output());
+        out << std::flush;
+        print_issues(issues, err);
+       }
+}
+
+
+//---------------------------------------------------------------------------
+// Do the job, returns the exit code
+int run(const int argc, const char* const argv[], std::ostream& out, std::ostream& err)
+{
+    try{
+        Arguments args(argc, argv, out); // std::span(argv, argc)
+        // Keep the messages apart if converting to the standard output
+        std::ostream& msgs = args.output_stream() ? err : out;
+        std::vector<std::string> issues{ args.issues() };
+
+        if( args.verbose() )
+           {
+            msgs << "---- llconv (ver. " << __DATE__ << ") ----\n";
+            msgs << "Running in: " << fs::current_path().string() << '\n';
+           }
+
+        if( args.files().empty() )
+           {
+            throw std::invalid_argument("No files passed");
+           }
+
+        if( args.clear() && args.output_isdir() )
+           {
+            if( args.output_isdefault() )
+               {
+                issues.push_back("Won't clear files in default output folder");
+               }
+            else
+               {
+                clear_output_files(args, issues, msgs);
+               }
+           }
+
+        // Collect the phases spans
+        std::optional<stats::Tracer> tracer;
+        if( !args.trace_path().empty() ) tracer.emplace();
+
+        // Incremental build
+        std::optional<build::Manifest> manifest;
+        const fs::path manifest_path{ args.output() / build::Manifest::file_name };
+        if( args.incremental() )
+           {
+            manifest.emplace( fmt::format("{} fussy:{} options:{}"sv, build_id, args.fussy(), args.options().to_str()) );
+            const stats::TraceSpan span("load-manifest"sv);
+            manifest->load(manifest_path);
+           }
+        build::Manifest* const manifest_ptr = manifest ? &manifest.value() : nullptr;
+
+        // Start watching before converting, to not miss anything
+        std::optional<sys::FilesWatcher> watcher;
+        if( args.watch() )
+           {
+            watcher.emplace();
+            for( const auto& file_path_obj : args.files() ) watcher->add(file_path_obj);
+           }
+
+        // Collect all the outputs in an archive
+        std::optional<tar::ArchiveWriter> output_archive;
+        if( !args.output_archive().empty() ) output_archive.emplace( args.output_archive().string() );
+
+        // Combine all the libraries in a single file
+        std::optional<CombinedOutput> combined;
+        if( !args.combined_output().empty() ) combined.emplace(args);
+
+        // Batch the writes of the outputs
+        std::optional<aio::OutputsBatch> outputs_batch;
+        if( args.io()==Arguments::IO::uring ) outputs_batch.emplace();
+
+        std::vector<stats::FileStats> files_stats;
+        std::vector<stats::FileStats>* const files_stats_ptr = args.stats() ? &files_stats : nullptr;
+        const auto t_start = stats::clock_type::now();
+
+        if( args.files().size()<2 )
+           {
+            convert_files_sequential(args, manifest_ptr, issues, files_stats_ptr, msgs);
+           }
+        else if( args.jobs()>1 )
+           {
+            convert_files_parallel(args, manifest_ptr, issues, files_stats_ptr, msgs);
+           }
+        else
+           {
+            convert_files_pipelined(args, manifest_ptr, issues, files_stats_ptr, msgs);
+           }
+        finish_writes(issues);
+
+        if( combined )
+           {
+            const stats::TraceSpan span("close-combined"sv);
+            combined->close(issues);
+           }
+
+        if( output_archive )
+           {
+            const stats::TraceSpan span("close-archive"sv);
+            output_archive->close();
+           }
+
+        if( args.stats() )
+           {
+            const double wall_secs = std::chrono::duration<double>(stats::clock_type::now() - t_start).count();
+            if( args.stats_json() ) stats::print_json(msgs, files_stats, wall_secs);
+            else stats::print_table(msgs, files_stats, wall_secs);
+           }
+
+        if( manifest )
+           {
+            const stats::TraceSpan span("save-manifest"sv);
+            manifest->save(manifest_path);
+           }
+
+        // Once for all the written files
+        if( args.sync() )
+           {
+            const stats::TraceSpan span("sync"sv);
+            if( !args.output_archive().empty() )
+               {// The outputs are there, not in the output folder
+                sys::sync_filesystem(args.output_archive());
+                if( manifest ) sys::sync_filesystem(args.output());
+               }
+            else
                {
-                std::cerr << "    " << issue << '\n';
+                sys::sync_filesystem(args.output());
                }
+           }
+
+        if( tracer )
+           {
+            tracer->write(args.trace_path().string());
+            tracer.reset(); // Not in watch mode
+           }
+
+        if( watcher )
+           {
+            msgs << std::flush;
+            print_issues(issues, err);
+            watch_files(*watcher, args, manifest_ptr, manifest_path, msgs, err);
+           }
+
+        if( issues.size()>0 )
+           {
+            msgs << std::flush;
+            print_issues(issues, err);
             return 1;
            }
 
@@ -433,14 +1627,160 @@ int main( const int argc, const char* const argv[] )
 
     catch( std::invalid_argument& e )
        {
-        std::cerr << "!! " << e.what() << '\n';
-        Arguments::print_usage();
+        out << std::flush;
+        err << "!! " << e.what() << '\n';
+        Arguments::print_usage(err);
        }
 
     catch( std::exception& e )
        {
-        std::cerr << "!! Error: " << e.what() << '\n';
+        out << std::flush;
+        err << "!! Error: " << e.what() << '\n';
        }
 
     return 2;
 }
+
+
+//---------------------------------------------------------------------------
+// Handle a conversion request coming from a client
+void serve_request(const ipc::Socket& client)
+{
+    // Collect the request
+    std::string cwd;
+    std::vector<std::string> req_args{ "llconv" };
+    while( true )
+       {
+        auto frame = client.recv_frame();
+        if( !frame ) throw std::runtime_error("Incomplete request");
+        if( frame->tag==ipc::Tag::run ) break;
+        else if( frame->tag==ipc::Tag::cwd ) cwd = std::move(frame->payload);
+        else if( frame->tag==ipc::Tag::arg ) req_args.push_back( std::move(frame->payload) );
+        else throw std::runtime_error("Unexpected frame in request");
+       }
+
+    ipc::FramesStreamBuf out_buf(client, ipc::Tag::out);
+    ipc::FramesStreamBuf err_buf(client, ipc::Tag::err);
+    std::ostream out(&out_buf);
+    std::ostream err(&err_buf);
+    int ret = 2;
+    auto reads_stdin = [&req_args]() noexcept
+       {// A '-' not meant as output
+        for( std::size_t i=1; i<req_args.size(); ++i )
+           {
+            if( req_args[i]=="-"sv && req_args[i-1]!="-output"sv && req_args[i-1]!="--output"sv && req_args[i-1]!="-o"sv && req_args[i-1]!="--o"sv ) return true;
+           }
+        return false;
+       };
+    if( std::ranges::any_of(req_args, [](const std::string& a){ return a=="-watch"sv || a=="--watch"sv; }) )
+       {
+        err << "!! Cannot watch files in server mode\n";
+       }
+    else if( reads_stdin() )
+       {
+        err << "!! Cannot read the standard input in server mode\n";
+       }
+    else
+       {
+        std::vector<const char*> argv;
+        argv.reserve(req_args.size());
+        for( const auto& a : req_args ) argv.push_back(a.c_str());
+        std::error_code ec;
+        fs::current_path(cwd, ec); // Relative paths are resolved as the client would
+        if( ec ) err << "!! Cannot enter " << cwd << '\n';
+        else ret = run(static_cast<int>(argv.size()), argv.data(), out, err);
+       }
+    out.flush();
+    err.flush();
+    client.send_frame(ipc::Tag::exit, std::to_string(ret));
+}
+
+
+//---------------------------------------------------------------------------
+// Stay resident serving the requests of the clients, one at a time
+[[noreturn]] void serve(const std::string& sock_path)
+{
+    const ipc::Socket server = ipc::Socket::listen(sock_path);
+    std::cout << "Serving on " << sock_path << ", press Ctrl+C to quit" << std::endl;
+    while( true )
+       {
+        const ipc::Socket client = server.accept();
+        if( !client.is_peer_same_user() )
+           {// Would act with the privileges of this process
+            std::cerr << "!! Rejected a connection of another user" << std::endl;
+            continue;
+           }
+        try{
+            serve_request(client);
+           }
+        catch( std::exception& e )
+           {
+            std::cerr << "!! Request failed: " << e.what() << std::endl;
+           }
+       }
+}
+
+
+//---------------------------------------------------------------------------
+// Let a server do the job, returns its exit code
+int forward(const std::string& sock_path, const int argc, const char* const argv[])
+{
+    const ipc::Socket server = ipc::Socket::connect(sock_path);
+    server.send_frame(ipc::Tag::cwd, fs::current_path().string());
+    for( int i=0; i<argc; ++i ) server.send_frame(ipc::Tag::arg, argv[i]);
+    server.send_frame(ipc::Tag::run, {});
+
+    while( const auto frame = server.recv_frame() )
+       {
+        switch( frame->tag )
+           {
+            case ipc::Tag::out :
+                std::cout << frame->payload;
+                break;
+
+            case ipc::Tag::err :
+                std::cout << std::flush;
+                std::cerr << frame->payload;
+                break;
+
+            case ipc::Tag::exit :
+                std::cout << std::flush;
+                return str::to_num<int>(frame->payload);
+
+            default :
+                throw std::runtime_error("Unexpected frame in response");
+           }
+       }
+    throw std::runtime_error("Server closed the connection");
+}
+
+
+
+//---------------------------------------------------------------------------
+int main( const int argc, const char* const argv[] )
+{
+    std::ios_base::sync_with_stdio(false); // Better performance
+
+    // Resident server and its clients
+    if( argc>=3 )
+       {
+        const std::string_view mode{ argv[1] };
+        try{
+            if( mode=="-server"sv || mode=="--server"sv )
+               {
+                serve(argv[2]);
+               }
+            else if( mode=="-client"sv || mode=="--client"sv )
+               {
+                return forward(argv[2], argc-3, argv+3);
+               }
+           }
+        catch( std::exception& e )
+           {
+            std::cerr << "!! Error: " << e.what() << '\n';
+            return 2;
+           }
+       }
+
+    return run(argc, argv, std::cout, std::cerr);
+}
@@ -0,0 +1,132 @@
+#ifndef GUARD_manifest_hpp
+#define GUARD_manifest_hpp
+/*  ---------------------------------------------
+    ©2022 matteo.gattanini@gmail.com
+
+    OVERVIEW
+    ---------------------------------------------
+    Record of the already converted inputs, kept
+    in the output directory to skip the unchanged
+    ones in the next runs
+
+    FORMAT
+    ---------------------------------------------
+    llconv-manifest
+    signature <tool version and options>
+    <content hash> <input file path>
+    ...
+
+    DEPENDENCIES:
+    --------------------------------------------- */
+#include <cstdint> // std::uint64_t
+#include <string>
+#include <string_view>
+#include <map>
+#include <charconv> // std::from_chars
+#include <fmt/core.h> // fmt::format
+
+#include "system.hpp" // sys::*, fs::*
+
+using namespace std::literals; // "..."sv
+
+
+//:::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+namespace build //:::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+{
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Entries loaded from the previous run are kept apart from the
+// updated ones, so 'is_unchanged()' can be called concurrently
+// while the main thread records the outcome of the conversions
+class Manifest final
+{
+ public:
+    static constexpr std::string_view file_name = ".llconv-manifest"sv;
+
+    explicit Manifest(const std::string& sig)
+      : i_signature(sig) {}
+
+    //-----------------------------------------------------------------------
+    // Read a previous manifest: a missing, broken or
+    // differently signed one is considered empty
+    void load(const fs::path& pth)
+       {
+        i_previous.clear();
+        i_entries.clear();
+        std::error_code ec;
+        if( !fs::is_regular_file(pth, ec) || fs::file_size(pth, ec)==0 ) return;
+
+        const sys::MemoryMappedFile buf(pth.string());
+        const std::string_view s = buf.as_string_view();
+        std::size_t i = 0;
+        auto next_line = [&s, &i]() noexcept -> std::string_view
+           {
+            const std::size_t i_start = i;
+            while( i<s.size() && s[i]!='\n' ) ++i;
+            const std::string_view line(s.data()+i_start, i-i_start);
+            if( i<s.size() ) ++i; // Skip '\n'
+            return line;
+           };
+
+        if( next_line()!="llconv-manifest"sv ) return;
+        const std::string_view sig_line = next_line();
+        if( !sig_line.starts_with("signature "sv) || sig_line.substr(10)!=i_signature ) return;
+
+        while( i<s.size() )
+           {
+            const std::string_view line = next_line();
+            const std::size_t i_sep = line.find(' ');
+            if( i_sep==std::string_view::npos ) continue;
+            std::uint64_t hash = 0;
+            const auto [p, ec] = std::from_chars(line.data(), line.data()+i_sep, hash, 16);
+            if( ec==std::errc() && p==line.data()+i_sep ) i_previous[std::string(line.substr(i_sep+1))] = hash;
+           }
+        i_entries = i_previous;
+       }
+
+    //-----------------------------------------------------------------------
+    void save(const fs::path& pth) const
+       {
+        sys::file_write f( pth.string() );
+        f << "llconv-manifest\n"sv
+          << "signature "sv << i_signature << '\n';
+        for( const auto& [key, hash] : i_entries )
+           {
+            f << fmt::format("{:016x} "sv, hash) << key << '\n';
+           }
+        f.close();
+       }
+
+    //-----------------------------------------------------------------------
+    [[nodiscard]] bool is_unchanged(const std::string& key, const std::uint64_t hash) const noexcept
+       {
+        const auto it = i_previous.find(key);
+        return it!=i_previous.end() && it->second==hash;
+       }
+
+    //-----------------------------------------------------------------------
+    void set(const std::string& key, const std::uint64_t hash)
+       {
+        i_entries[key] = hash;
+       }
+
+    //-----------------------------------------------------------------------
+    void remove(const std::string& key)
+       {
+        i_entries.erase(key);
+       }
+
+ private:
+    std::string i_signature; // Tool version and conversion options
+    std::map<std::string,std::uint64_t> i_previous; // Input path → content hash
+    std::map<std::string,std::uint64_t> i_entries; // Updated in this run
+};
+
+
+}//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+
+
+//---- end unit -------------------------------------------------------------
+#endif
@@ -0,0 +1,263 @@
+#ifndef GUARD_parallel_hpp
+#define GUARD_parallel_hpp
+/*  ---------------------------------------------
+    ©2022 matteo.gattanini@gmail.com
+
+    OVERVIEW
+    ---------------------------------------------
+    Multithreading facilities
+
+    DEPENDENCIES:
+    --------------------------------------------- */
+#include <cstdint> // std::uintmax_t
+#include <vector>
+#include <deque>
+#include <numeric> // std::iota
+#include <algorithm> // std::sort, std::min
+#include <thread> // std::thread
+#include <atomic> // std::atomic_bool
+#include <mutex> // std::mutex, std::scoped_lock, std::unique_lock
+#include <condition_variable> // std::condition_variable
+#include <optional> // std::optional
+#include <exception> // std::exception_ptr
+
+
+//:::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+namespace mt //::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+{
+
+
+//---------------------------------------------------------------------------
+// Number of workers to use when user asks for "all"
+[[nodiscard]] std::size_t available_cores() noexcept
+{
+    const unsigned int n = std::thread::hardware_concurrency();
+    return n>0 ? n : 1u;
+}
+
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Run 'task(idx)' for each index of 'weights' on a bunch of workers.
+// Tasks are dealt to the workers heaviest first, an idle worker
+// steals the heaviest pending task from the others, so a single
+// huge task cannot end up queued behind a lot of small ones.
+// Note: 'task' should handle its own exceptions, anything escaped
+//       will be rethrown after all workers have finished
+class LargestFirstPool final
+{
+ public:
+    explicit LargestFirstPool(const std::vector<std::uintmax_t>& weights, const std::size_t n_workers)
+      : i_weights(weights)
+      , i_queues( std::max<std::size_t>(1u, std::min(n_workers, weights.size())) )
+       {
+        // Sort tasks by decreasing weight
+        i_order.resize(weights.size());
+        std::iota(i_order.begin(), i_order.end(), 0u);
+        std::stable_sort(i_order.begin(), i_order.end(), [&weights](const std::size_t a, const std::size_t b) noexcept { return weights[a]>weights[b]; });
+
+        // Deal them round robin, each queue stays sorted
+        for( std::size_t k=0; k<i_order.size(); ++k )
+           {
+            i_queues[k % i_queues.size()].tasks.push_back(i_order[k]);
+           }
+       }
+
+    LargestFirstPool(const LargestFirstPool&) = delete;
+    LargestFirstPool(LargestFirstPool&&) = delete;
+    LargestFirstPool& operator=(const LargestFirstPool&) = delete;
+    LargestFirstPool& operator=(LargestFirstPool&&) = delete;
+
+    // Tasks indexes as they'll be started, roughly
+    [[nodiscard]] const std::vector<std::size_t>& order() const noexcept { return i_order; }
+
+    // The pending tasks won't be started
+    void stop() noexcept { i_stopped = true; }
+
+    template<typename F> void run(F&& task)
+       {
+        std::vector<std::thread> workers;
+        workers.reserve(i_queues.size()-1u);
+        try{
+            for( std::size_t w=1; w<i_queues.size(); ++w )
+               {
+                workers.emplace_back([this, &task, w]{ work(w, task); });
+               }
+           }
+        catch(...)
+           {// Couldn't start a thread, don't leave the others joinable
+            stop();
+            for( auto& worker : workers ) worker.join();
+            throw;
+           }
+        work(0, task); // The caller is a worker too
+        for( auto& worker : workers ) worker.join();
+
+        if( i_error ) std::rethrow_exception(i_error);
+       }
+
+ private:
+    struct TasksQueue
+       {
+        std::mutex mtx;
+        std::deque<std::size_t> tasks; // Sorted by decreasing weight
+       };
+
+    const std::vector<std::uintmax_t>& i_weights;
+    std::vector<std::size_t> i_order; // By decreasing weight
+    std::vector<TasksQueue> i_queues;
+    std::mutex i_error_mtx;
+    std::exception_ptr i_error;
+    std::atomic_bool i_stopped{false};
+
+    //-----------------------------------------------------------------------
+    template<typename F> void work(const std::size_t w, F& task) noexcept
+       {
+        while( const auto idx = next_task(w) )
+           {
+            try{
+                task( idx.value() );
+               }
+            catch(...)
+               {
+                const std::scoped_lock lock(i_error_mtx);
+                if( !i_error ) i_error = std::current_exception();
+               }
+           }
+       }
+
+    //-----------------------------------------------------------------------
+    [[nodiscard]] std::optional<std::size_t> next_task(const std::size_t w) noexcept
+       {
+        if( i_stopped ) return std::nullopt;
+
+        // Own queue first
+           {
+            TasksQueue& q = i_queues[w];
+            const std::scoped_lock lock(q.mtx);
+            if( !q.tasks.empty() )
+               {
+                const std::size_t idx = q.tasks.front();
+                q.tasks.pop_front();
+                return idx;
+               }
+           }
+
+        // Then steal the heaviest pending task
+        while( true )
+           {
+            std::size_t victim = i_queues.size();
+            std::uintmax_t max_weight = 0;
+            for( std::size_t v=0; v<i_queues.size(); ++v )
+               {
+                TasksQueue& q = i_queues[v];
+                const std::scoped_lock lock(q.mtx);
+                if( !q.tasks.empty() && (victim==i_queues.size() || i_weights[q.tasks.front()]>max_weight) )
+                   {
+                    victim = v;
+                    max_weight = i_weights[q.tasks.front()];
+                   }
+               }
+            if( victim==i_queues.size() )
+               {// Nothing left
+                return std::nullopt;
+               }
+
+            TasksQueue& q = i_queues[victim];
+            const std::scoped_lock lock(q.mtx);
+            if( !q.tasks.empty() )
+               {
+                const std::size_t idx = q.tasks.front();
+                q.tasks.pop_front();
+                return idx;
+               }
+            // Someone else was faster, retry
+           }
+       }
+};
+
+
+
+/////////////////////////////////////////////////////////////////////////////
+// A fixed capacity FIFO to pass data between pipeline stages:
+// producers wait when full, consumers wait when empty
+template<typename T> class BoundedQueue final
+{
+ public:
+    explicit BoundedQueue(const std::size_t cap) noexcept
+      : i_capacity(cap>0 ? cap : 1u) {}
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue(BoundedQueue&&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(BoundedQueue&&) = delete;
+
+    //-----------------------------------------------------------------------
+    // Returns false if the queue was closed
+    [[nodiscard]] bool push(T&& item)
+       {
+        std::unique_lock lock(i_mtx);
+        i_not_full.wait(lock, [this]{ return i_items.size()<i_capacity || i_closed; });
+        if( i_closed ) return false;
+        i_items.push_back( std::move(item) );
+        lock.unlock();
+        i_not_empty.notify_one();
+        return true;
+       }
+
+    //-----------------------------------------------------------------------
+    // Returns nothing when closed and drained
+    [[nodiscard]] std::optional<T> pop()
+       {
+        std::unique_lock lock(i_mtx);
+        i_not_empty.wait(lock, [this]{ return !i_items.empty() || i_closed; });
+        if( i_items.empty() ) return std::nullopt;
+        std::optional<T> item{ std::move(i_items.front()) };
+        i_items.pop_front();
+        lock.unlock();
+        i_not_full.notify_one();
+        return item;
+       }
+
+    //-----------------------------------------------------------------------
+    // No more items will be pushed, the remaining ones can be popped
+    void close() noexcept
+       {
+           {
+            const std::scoped_lock lock(i_mtx);
+            i_closed = true;
+           }
+        i_not_full.notify_all();
+        i_not_empty.notify_all();
+       }
+
+    //-----------------------------------------------------------------------
+    // Close and discard the remaining items
+    void cancel() noexcept
+       {
+        std::deque<T> discarded;
+           {
+            const std::scoped_lock lock(i_mtx);
+            i_closed = true;
+            discarded.swap(i_items);
+           }
+        i_not_full.notify_all();
+        i_not_empty.notify_all();
+       }
+
+ private:
+    const std::size_t i_capacity;
+    std::mutex i_mtx;
+    std::condition_variable i_not_full;
+    std::condition_variable i_not_empty;
+    std::deque<T> i_items;
+    bool i_closed = false;
+};
+
+
+}//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+
+
+//---- end unit -------------------------------------------------------------
+#endif
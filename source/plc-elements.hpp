@@ -644,6 +644,22 @@ class Library final
                 // && interfaces().empty();
        }
 
+    std::size_t elements_count() const noexcept
+       {
+        return global_constants().size()
+             + global_retainvars().size()
+             + global_variables().size()
+             + programs().size()
+             + function_blocks().size()
+             + functions().size()
+             + macros().size()
+             + structs().size()
+             + typedefs().size()
+             + enums().size()
+             + subranges().size();
+             // + interfaces().size();
+       }
+
     void check() const
        {
         // Global constants must have a value (already checked in parsing)
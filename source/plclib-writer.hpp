@@ -11,13 +11,15 @@
     --------------------------------------------- */
 #include <string>
 #include <string_view>
-#include <cstdint> // uint16_t, uint32_t
+#include <array>
+#include <vector>
+#include <cstdint> // uint16_t, uint32_t, uint8_t
 #include <limits> // std::numeric_limits
-#include <cctype> // std::isdigit
 //#include <type_traits> // std::enable_if, std::is_unsigned
 #include <stdexcept> // std::exception, std::runtime_error, ...
 #include <fmt/core.h> // fmt::format
 
+#include "ascii.hpp" // ascii::is_digit
 #include "string-utilities.hpp" // str::to_num, str::hash
 #include "keyvals.hpp" // str::keyvals
 #include "plc-elements.hpp" // plcb::*
@@ -44,12 +46,12 @@ class Version final
             const std::size_t siz = s.size();
             std::size_t i = 0;
             std::size_t i_start = i;
-            while( i<siz && std::isdigit(s[i]) ) ++i;
+            while( i<siz && ascii::is_digit(s[i]) ) ++i;
             const uint16_t majv = str::to_num<uint16_t>( std::string_view(s.data()+i_start, i-i_start) );
             if( i>=siz || s[i]!='.' ) throw std::runtime_error("Missing \'.\' after major version");
             ++i; // Skip '.'
             i_start = i;
-            while( i<siz && std::isdigit(s[i]) ) ++i;
+            while( i<siz && ascii::is_digit(s[i]) ) ++i;
             if( i<siz ) throw std::runtime_error("Unexpected content after minor version");
             const uint16_t minv = str::to_num<uint16_t>( std::string_view(s.data()+i_start, i-i_start) );
             set_version(majv, minv);
@@ -84,7 +86,7 @@ class Version final
 
 //---------------------------------------------------------------------------
 // Write variable to plclib file
-inline void write(const sys::file_write& f, const plcb::Variable& var, const std::string_view tag, const std::string_view ind)
+template<typename W> inline void write(W& f, const plcb::Variable& var, const std::string_view tag, const std::string_view ind)
 {
     assert( !var.name().empty() );
 
@@ -131,7 +133,7 @@ inline void write(const sys::file_write& f, const plcb::Variable& var, const std
 
 //---------------------------------------------------------------------------
 // Write POU to plclib file
-inline void write(const sys::file_write& f, const plcb::Pou& pou, const std::string_view tag, const std::string_view ind)
+template<typename W> inline void write(W& f, const plcb::Pou& pou, const std::string_view tag, const std::string_view ind)
 {
     f<< ind << '<' << tag << " name=\""sv << pou.name() << "\" version=\"1.0.0\" creationDate=\"0\" lastModifiedDate=\"0\" excludeFromBuild=\"FALSE\" excludeFromBuildIfNotDef=\"\">\n"sv;
     if( pou.has_descr() )
@@ -192,7 +194,7 @@ inline void write(const sys::file_write& f, const plcb::Pou& pou, const std::str
 
     // [Body]
     f<< ind << "\t<sourceCode type=\""sv << pou.code_type() << "\">\n"sv
-     << ind << "\t\t<![CDATA["sv << pou.body() << "]]>\n"sv
+     << ind << "\t\t<![CDATA["sv << sys::lasting_view{pou.body()} << "]]>\n"sv
      << ind << "\t</sourceCode>\n"sv;
 
     f<< ind << "</"sv << tag << ">\n"sv;
@@ -201,7 +203,7 @@ inline void write(const sys::file_write& f, const plcb::Pou& pou, const std::str
 
 //---------------------------------------------------------------------------
 // Write macro to plclib file
-inline void write(const sys::file_write& f, const plcb::Macro& macro, const std::string_view ind)
+template<typename W> inline void write(W& f, const plcb::Macro& macro, const std::string_view ind)
 {
     f<< ind << "<macro name=\""sv << macro.name() << "\">\n"sv;
     if( macro.has_descr() )
@@ -211,7 +213,7 @@ inline void write(const sys::file_write& f, const plcb::Macro& macro, const std:
 
     // [Body]
     f<< ind << "\t<sourceCode type=\""sv << macro.code_type() << "\">\n"sv
-     << ind << "\t\t<![CDATA["sv << macro.body() << "]]>\n"sv
+     << ind << "\t\t<![CDATA["sv << sys::lasting_view{macro.body()} << "]]>\n"sv
      << ind << "\t</sourceCode>\n"sv;
 
     // [Parameters]
@@ -235,8 +237,76 @@ inline void write(const sys::file_write& f, const plcb::Macro& macro, const std:
 
 
 //---------------------------------------------------------------------------
-// Write library to plclib file
-void write(const sys::file_write& f, const plcb::Library& lib, const str::keyvals& options)
+// The sections of the library element, in order
+enum class Section : std::uint8_t
+{
+    workspace,
+    global_vars,
+    retain_vars,
+    constant_vars,
+    iec_vars_declaration,
+    functions,
+    function_blocks,
+    programs,
+    macros,
+    structs,
+    typedefs,
+    enums,
+    subranges
+};
+inline constexpr std::size_t sections_count = 13;
+inline constexpr std::array<std::string_view, sections_count> sections_tags = { "libWorkspace"sv, "globalVars"sv, "retainVars"sv, "constantVars"sv, "iecVarsDeclaration"sv,
+                                                                                "functions"sv, "functionBlocks"sv, "programs"sv, "macros"sv, "structs"sv, "typedefs"sv, "enums"sv, "subranges"sv };
+
+
+//---------------------------------------------------------------------------
+[[nodiscard]] inline bool has_content(const plcb::Library& lib, const Section sect) noexcept
+{
+    switch( sect )
+       {
+        case Section::workspace : return true;
+        case Section::global_vars : return !lib.global_variables().is_empty();
+        case Section::retain_vars : return !lib.global_retainvars().is_empty();
+        case Section::constant_vars : return !lib.global_constants().is_empty();
+        case Section::iec_vars_declaration : return lib.global_constants().has_nonempty_named_group() ||
+                                                    lib.global_retainvars().has_nonempty_named_group() ||
+                                                    lib.global_variables().has_nonempty_named_group();
+        case Section::functions : return !lib.functions().empty();
+        case Section::function_blocks : return !lib.function_blocks().empty();
+        case Section::programs : return !lib.programs().empty();
+        case Section::macros : return !lib.macros().empty();
+        case Section::structs : return !lib.structs().empty();
+        case Section::typedefs : return !lib.typedefs().empty();
+        case Section::enums : return !lib.enums().empty();
+        case Section::subranges : return !lib.subranges().empty();
+       }
+    return false;
+}
+
+
+//---------------------------------------------------------------------------
+template<typename W> void write_section_open(W& f, const Section sect)
+{
+    f<< "\t\t<"sv << sections_tags[static_cast<std::size_t>(sect)] << ">\n"sv;
+}
+
+//---------------------------------------------------------------------------
+template<typename W> void write_section_close(W& f, const Section sect)
+{
+    f<< "\t\t</"sv << sections_tags[static_cast<std::size_t>(sect)] << ">\n"sv;
+}
+
+//---------------------------------------------------------------------------
+template<typename W> void write_section_empty(W& f, const Section sect)
+{
+    if( sect==Section::iec_vars_declaration ) return; // Omitted when empty
+    f<< "\t\t<"sv << sections_tags[static_cast<std::size_t>(sect)] << "/>\n"sv;
+}
+
+
+//---------------------------------------------------------------------------
+// Write the heading, up to the library description
+template<typename W> void write_heading(W& f, const std::string_view name, const std::string_view version, const std::string_view descr, const str::keyvals& options)
 {
     // [Options]
     // Get possible schema version
@@ -247,12 +317,195 @@ void write(const sys::file_write& f, const plcb::Library& lib, const str::keyval
         schema_ver = schema_ver_str.value();
        }
 
-    // [Heading]
     f << "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"no\"?>\n"sv
       << "<plcLibrary schemaVersion=\""sv << schema_ver.to_str() << "\">\n"sv
-      << "\t<lib version=\""sv << lib.version() << "\" name=\""sv << lib.name() << "\" fullXml=\"true\">\n"sv
+      << "\t<lib version=\""sv << version << "\" name=\""sv << name << "\" fullXml=\"true\">\n"sv
       << "\t\t<!-- author=\"llconv plclib::write()\" date=\""sv << sys::human_readable_time_stamp() << "\" -->\n"sv
-      << "\t\t<descr>"sv << lib.descr() << "</descr>\n"sv;
+      << "\t\t<descr>"sv << descr << "</descr>\n"sv;
+}
+
+
+//---------------------------------------------------------------------------
+template<typename W> void write_closing(W& f)
+{
+    // [Interfaces]
+    //if( !lib.interfaces().empty() )
+    //   {
+    //    f<< "\t\t<interfaces>\n"sv;
+    //    for( const auto& intfc : lib.interfaces() ) write(f, intfc, "interface"sv);
+    //    f<< "\t\t</interfaces>\n"sv;
+    //   }
+    //else
+    //   {
+          f<< "\t\t<interfaces/>\n"sv;
+    //   }
+
+    // [Closing]
+    f<< "\t</lib>\n"sv
+     << "</plcLibrary>\n"sv;
+}
+
+
+//---------------------------------------------------------------------------
+// Write the content of a section of the library, without the enclosing tag
+template<typename W> void write_section_content(W& f, const plcb::Library& lib, const Section sect)
+{
+    const std::string_view ind{"\t\t\t"sv};
+
+    switch( sect )
+       {
+        case Section::workspace :
+            f<< "\t\t\t<folder name=\""sv << lib.name() << "\" id=\""sv << std::to_string(str::hash(lib.name())) << "\">\n"sv;
+                for( const auto& grp : lib.global_constants().groups() ) if( grp.has_name() )  f<< "\t\t\t\t<GlobalVars name=\""sv << grp.name() << "\"/>\n"sv;
+                for( const auto& grp : lib.global_retainvars().groups() ) if( grp.has_name() ) f<< "\t\t\t\t<GlobalVars name=\""sv << grp.name() << "\"/>\n"sv;
+                for( const auto& grp : lib.global_variables().groups() ) if( grp.has_name() )  f<< "\t\t\t\t<GlobalVars name=\""sv << grp.name() << "\"/>\n"sv;
+                for( const auto& pou : lib.function_blocks() ) f<< "\t\t\t\t<Pou name=\""sv << pou.name() << "\"/>\n"sv;
+                for( const auto& pou : lib.functions() )       f<< "\t\t\t\t<Pou name=\""sv << pou.name() << "\"/>\n"sv;
+                for( const auto& pou : lib.programs() )        f<< "\t\t\t\t<Pou name=\""sv << pou.name() << "\"/>\n"sv;
+                // Definitions
+                for( const auto& def : lib.macros() )   f<< "\t\t\t\t<Definition name=\""sv << def.name() << "\"/>\n"sv;
+                for( const auto& def : lib.structs() )  f<< "\t\t\t\t<Definition name=\""sv << def.name() << "\"/>\n"sv;
+                for( const auto& def : lib.typedefs() ) f<< "\t\t\t\t<Definition name=\""sv << def.name() << "\"/>\n"sv;
+                for( const auto& def : lib.enums() )    f<< "\t\t\t\t<Definition name=\""sv << def.name() << "\"/>\n"sv;
+                for( const auto& def : lib.subranges() ) f<< "\t\t\t\t<Definition name=\""sv << def.name() << "\"/>\n"sv;
+                //for( const auto& def : lib.interfaces() ) f<< "\t\t\t\t<Definition name=\""sv << def.name() << "\"/>\n"sv;
+            f<< "\t\t\t</folder>\n"sv;
+            break;
+
+        case Section::global_vars :
+            for( const auto& group : lib.global_variables().groups() )
+               {
+                f << "\t\t\t<group name=\""sv << group.name() << "\" excludeFromBuild=\"FALSE\" excludeFromBuildIfNotDef=\"\" version=\"1.0.0\">\n"sv;
+                for( const auto& var : group.variables() ) write(f, var, "var"sv, "\t\t\t\t"sv);
+                f<< "\t\t\t</group>\n"sv;
+               }
+            break;
+
+        case Section::retain_vars :
+            for( const auto& group : lib.global_retainvars().groups() )
+               {
+                f << "\t\t\t<group name=\""sv << group.name() << "\" excludeFromBuild=\"FALSE\" excludeFromBuildIfNotDef=\"\" version=\"1.0.0\">\n"sv;
+                for( const auto& var : group.variables() ) write(f, var, "var"sv, "\t\t\t\t"sv);
+                f<< "\t\t\t</group>\n"sv;
+               }
+            break;
+
+        case Section::constant_vars :
+            for( const auto& group : lib.global_constants().groups() )
+               {
+                f << "\t\t\t<group name=\""sv << group.name() << "\" excludeFromBuild=\"FALSE\" excludeFromBuildIfNotDef=\"\" version=\"1.0.0\">\n"sv;
+                for( const auto& var : group.variables() ) write(f, var, "const"sv, "\t\t\t\t"sv);
+                f<< "\t\t\t</group>\n"sv;
+               }
+            break;
+
+        case Section::iec_vars_declaration :
+            for( const auto* vars : {&lib.global_constants(), &lib.global_retainvars(), &lib.global_variables()} )
+               {
+                for( const auto& group : vars->groups() )
+                   {
+                    if( group.has_name() )
+                       {
+                        f<< "\t\t\t<group name=\""sv << group.name() << "\">\n"sv
+                         << "\t\t\t\t<iecDeclaration active=\"FALSE\"/>\n"sv
+                         << "\t\t\t</group>\n"sv;
+                       }
+                   }
+               }
+            break;
+
+        case Section::functions :
+            for( const auto& pou : lib.functions() ) write(f, pou, "function"sv, ind);
+            break;
+
+        case Section::function_blocks :
+            for( const auto& pou : lib.function_blocks() ) write(f, pou, "functionBlock"sv, ind);
+            break;
+
+        case Section::programs :
+            for( const auto& pou : lib.programs() ) write(f, pou, "program"sv, ind);
+            break;
+
+        case Section::macros :
+            for( const auto& macro : lib.macros() ) write(f, macro, ind);
+            break;
+
+        case Section::structs :
+            for( const auto& strct : lib.structs() )
+               {
+                f<< ind << "<struct name=\""sv << strct.name() << "\" version=\"1.0.0\">\n"sv;
+                f<< ind << "\t<descr>"sv << strct.descr() << "</descr>\n"sv;
+                f<< ind << "\t<vars>\n"sv;
+                for( const auto& var : strct.members() )
+                   {
+                    f<< ind << "\t\t<var name=\""sv << var.name() << "\" type=\""sv << var.type() << "\">\n"sv
+                     << ind << "\t\t\t<descr>"sv << var.descr() << "</descr>\n"sv
+                     << ind << "\t\t</var>\n"sv;
+                   }
+                f<< ind << "\t</vars>\n"sv;
+                f<< ind << "\t<iecDeclaration active=\"FALSE\"/>\n"sv;
+                f<< ind << "</struct>\n"sv;
+               }
+            break;
+
+        case Section::typedefs :
+            for( const auto& tdef : lib.typedefs() )
+               {
+                f<< ind << "<typedef name=\""sv << tdef.name() << "\" type=\""sv << tdef.type() << '\"';
+                if( tdef.has_length() ) f<< " length=\""sv << std::to_string(tdef.length()) << '\"';
+                if( tdef.is_array() )
+                   {
+                    if( tdef.array_startidx()!=0u ) throw std::runtime_error(fmt::format("plclib doesn't support arrays with a not null start index in typedef {}",tdef.name()));
+                    f<< " dim0=\""sv << std::to_string(tdef.array_dim()) << '\"';
+                   }
+                f<< ">\n"sv;
+                f<< ind << "\t<iecDeclaration active=\"FALSE\"/>\n"sv;
+                f<< ind << "\t<descr>"sv << tdef.descr() << "</descr>\n"sv;
+                f<< ind << "</typedef>\n"sv;
+               }
+            break;
+
+        case Section::enums :
+            for( const auto& en : lib.enums() )
+               {
+                f<< ind << "<enum name=\""sv << en.name() << "\" version=\"1.0.0\">\n"sv;
+                f<< ind << "\t<descr>"sv << en.descr() << "</descr>\n"sv;
+                f<< ind << "\t<elements>\n"sv;
+                for( const auto& elem : en.elements() )
+                   {
+                    f<< ind << "\t\t<element name=\""sv << elem.name() << "\">\n"sv
+                     << ind << "\t\t\t<descr>"sv << elem.descr() << "</descr>\n"sv
+                     << ind << "\t\t\t<value>"sv << elem.value() << "</value>\n"sv
+                     << ind << "\t\t</element>\n"sv;
+                   }
+                f<< ind << "\t</elements>\n"sv;
+                f<< ind << "\t<iecDeclaration active=\"FALSE\"/>\n"sv;
+                f<< ind << "</enum>\n"sv;
+               }
+            break;
+
+        case Section::subranges :
+            for( const auto& subr : lib.subranges() )
+               {
+                f<< ind << "<subrange name=\""sv << subr.name() << "\" version=\"1.0.0\" type=\""sv << subr.type() << "\">\n"sv;
+                //f<< ind << "\t<title>"sv << subr.title() << "</title>\n"sv;
+                f<< ind << "\t<descr>"sv << subr.descr() << "</descr>\n"sv;
+                f<< ind << "\t<minValue>"sv << std::to_string(subr.min_value()) << "</minValue>\n"sv;
+                f<< ind << "\t<maxValue>"sv << std::to_string(subr.max_value()) << "</maxValue>\n"sv;
+                f<< ind << "\t<iecDeclaration active=\"FALSE\"/>\n"sv;
+                f<< ind << "</subrange>\n"sv;
+               }
+            break;
+       }
+}
+
+
+//---------------------------------------------------------------------------
+// Write library to plclib file
+template<typename W> void write(W& f, const plcb::Library& lib, const str::keyvals& options)
+{
+    // [Heading]
+    write_heading(f, lib.name(), lib.version(), lib.descr(), options);
 
     // Content summary
     f << "\t\t<!--\n"sv;
@@ -270,285 +523,107 @@ void write(const sys::file_write& f, const plcb::Library& lib, const str::keyval
     //if( !lib.interfaces().empty() )           f<< "\t\t\tinterfaces: "sv << std::to_string(lib.interfaces().size())  << '\n';
     f << "\t\t-->\n"sv;
 
-    // [Workspace]
-    f<< "\t\t<libWorkspace>\n"sv;
-    f<< "\t\t\t<folder name=\""sv << lib.name() << "\" id=\""sv << std::to_string(str::hash(lib.name())) << "\">\n"sv;
-        for( const auto& grp : lib.global_constants().groups() ) if( grp.has_name() )  f<< "\t\t\t\t<GlobalVars name=\""sv << grp.name() << "\"/>\n"sv;
-        for( const auto& grp : lib.global_retainvars().groups() ) if( grp.has_name() ) f<< "\t\t\t\t<GlobalVars name=\""sv << grp.name() << "\"/>\n"sv;
-        for( const auto& grp : lib.global_variables().groups() ) if( grp.has_name() )  f<< "\t\t\t\t<GlobalVars name=\""sv << grp.name() << "\"/>\n"sv;
-        for( const auto& pou : lib.function_blocks() ) f<< "\t\t\t\t<Pou name=\""sv << pou.name() << "\"/>\n"sv;
-        for( const auto& pou : lib.functions() )       f<< "\t\t\t\t<Pou name=\""sv << pou.name() << "\"/>\n"sv;
-        for( const auto& pou : lib.programs() )        f<< "\t\t\t\t<Pou name=\""sv << pou.name() << "\"/>\n"sv;
-        // Definitions
-        for( const auto& def : lib.macros() )   f<< "\t\t\t\t<Definition name=\""sv << def.name() << "\"/>\n"sv;
-        for( const auto& def : lib.structs() )  f<< "\t\t\t\t<Definition name=\""sv << def.name() << "\"/>\n"sv;
-        for( const auto& def : lib.typedefs() ) f<< "\t\t\t\t<Definition name=\""sv << def.name() << "\"/>\n"sv;
-        for( const auto& def : lib.enums() )    f<< "\t\t\t\t<Definition name=\""sv << def.name() << "\"/>\n"sv;
-        for( const auto& def : lib.subranges() ) f<< "\t\t\t\t<Definition name=\""sv << def.name() << "\"/>\n"sv;
-        //for( const auto& def : lib.interfaces() ) f<< "\t\t\t\t<Definition name=\""sv << def.name() << "\"/>\n"sv;
-    f<< "\t\t\t</folder>\n"sv;
-    f<< "\t\t</libWorkspace>\n"sv;
-
-    // [Global variables]
-    if( !lib.global_variables().is_empty() )
+    // [Sections]
+    for( std::size_t i=0; i<sections_count; ++i )
        {
-        f<< "\t\t<globalVars>\n"sv;
-        for( const auto& group : lib.global_variables().groups() )
+        const auto sect = static_cast<Section>(i);
+        if( has_content(lib, sect) )
            {
-            f << "\t\t\t<group name=\""sv << group.name() << "\" excludeFromBuild=\"FALSE\" excludeFromBuildIfNotDef=\"\" version=\"1.0.0\">\n"sv;
-            for( const auto& var : group.variables() ) write(f, var, "var"sv, "\t\t\t\t"sv);
-            f<< "\t\t\t</group>\n"sv;
+            write_section_open(f, sect);
+            write_section_content(f, lib, sect);
+            write_section_close(f, sect);
            }
-        f<< "\t\t</globalVars>\n"sv;
-       }
-    else
-       {
-        f<< "\t\t<globalVars/>\n"sv;
-       }
-
-    // [Global retain variables]
-    if( !lib.global_retainvars().is_empty() )
-       {
-        f<< "\t\t<retainVars>\n"sv;
-        for( const auto& group : lib.global_retainvars().groups() )
+        else
            {
-            f << "\t\t\t<group name=\""sv << group.name() << "\" excludeFromBuild=\"FALSE\" excludeFromBuildIfNotDef=\"\" version=\"1.0.0\">\n"sv;
-            for( const auto& var : group.variables() ) write(f, var, "var"sv, "\t\t\t\t"sv);
-            f<< "\t\t\t</group>\n"sv;
+            write_section_empty(f, sect);
            }
-        f<< "\t\t</retainVars>\n"sv;
        }
-    else
-       {
-        f<< "\t\t<retainVars/>\n"sv;
-       }
-
-    // [Global constants]
-    if( !lib.global_constants().is_empty() )
-       {
-        f<< "\t\t<constantVars>\n"sv;
-        for( const auto& group : lib.global_constants().groups() )
-           {
-            f << "\t\t\t<group name=\""sv << group.name() << "\" excludeFromBuild=\"FALSE\" excludeFromBuildIfNotDef=\"\" version=\"1.0.0\">\n"sv;
-            for( const auto& var : group.variables() ) write(f, var, "const"sv, "\t\t\t\t"sv);
-            f<< "\t\t\t</group>\n"sv;
-           }
-        f<< "\t\t</constantVars>\n"sv;
-       }
-    else
-       {
-        f<< "\t\t<constantVars/>\n"sv;
-       }
-
-    // [Global variables groups]
-    if( lib.global_constants().has_nonempty_named_group() ||
-        lib.global_retainvars().has_nonempty_named_group() ||
-        lib.global_variables().has_nonempty_named_group() )
-       {
-        f << "\t\t<iecVarsDeclaration>\n"sv;
-
-        for( const auto& group : lib.global_constants().groups() )
-           {
-            if( group.has_name() )
-               {
-                f<< "\t\t\t<group name=\""sv << group.name() << "\">\n"sv
-                 << "\t\t\t\t<iecDeclaration active=\"FALSE\"/>\n"sv
-                 << "\t\t\t</group>\n"sv;
-               }
-           }
-
-        for( const auto& group : lib.global_retainvars().groups() )
-           {
-            if( group.has_name() )
-               {
-                f<< "\t\t\t<group name=\""sv << group.name() << "\">\n"sv
-                 << "\t\t\t\t<iecDeclaration active=\"FALSE\"/>\n"sv
-                 << "\t\t\t</group>\n"sv;
-               }
-           }
 
-        for( const auto& group : lib.global_variables().groups() )
-           {
-            if( group.has_name() )
-               {
-                f<< "\t\t\t<group name=\""sv << group.name() << "\">\n"sv
-                 << "\t\t\t\t<iecDeclaration active=\"FALSE\"/>\n"sv
-                 << "\t\t\t</group>\n"sv;
-               }
-           }
+    write_closing(f);
+}
 
-        f<< "\t\t</iecVarsDeclaration>\n"sv;
-       }
-    //else
-    //   {
-    //    f<< "\t\t<iecVarsDeclaration/>\n"sv;
-    //   }
 
-    const std::string_view ind{"\t\t\t"sv};
 
-    // [Functions]
-    if( !lib.functions().empty() )
-       {
-        f<< "\t\t<functions>\n"sv;
-        for( const auto& pou : lib.functions() ) write(f, pou, "function"sv, ind);
-        f<< "\t\t</functions>\n"sv;
-       }
-    else
-       {
-        f<< "\t\t<functions/>\n"sv;
-       }
-
-    // [FunctionBlocks]
-    if( !lib.function_blocks().empty() )
-       {
-        f<< "\t\t<functionBlocks>\n"sv;
-        for( const auto& pou : lib.function_blocks() ) write(f, pou, "functionBlock"sv, ind);
-        f<< "\t\t</functionBlocks>\n"sv;
-       }
-    else
-       {
-        f<< "\t\t<functionBlocks/>\n"sv;
-       }
-
-    // [Programs]
-    if( !lib.programs().empty() )
-       {
-        f<< "\t\t<programs>\n"sv;
-        for( const auto& pou : lib.programs() ) write(f, pou, "program"sv, ind);
-        f<< "\t\t</programs>\n"sv;
-       }
-    else
+/////////////////////////////////////////////////////////////////////////////
+// Several libraries combined in a single plclib file: since the
+// elements are grouped by kind, the content of each section is
+// spilled to a temporary file as the libraries come, and the file
+// is assembled at the end
+class CombinedWriter final
+{
+ public:
+    // The sections content of a library, ready to be added
+    struct Part
        {
-        f<< "\t\t<programs/>\n"sv;
-       }
+        std::string lib_name;
+        std::array<std::string, sections_count> sections;
+       };
 
-    // [Macros]
-    if( !lib.macros().empty() )
-       {
-        f<< "\t\t<macros>\n"sv;
-        for( const auto& macro : lib.macros() ) write(f, macro, ind);
-        f<< "\t\t</macros>\n"sv;
-       }
-    else
-       {
-        f<< "\t\t<macros/>\n"sv;
-       }
+    explicit CombinedWriter(std::string pth)
+      : i_path(std::move(pth)) {}
 
-    // [Structs]
-    if( !lib.structs().empty() )
+    //-----------------------------------------------------------------------
+    [[nodiscard]] static Part render(const plcb::Library& lib)
        {
-        f<< "\t\t<structs>\n"sv;
-        for( const auto& strct : lib.structs() )
+        Part part;
+        part.lib_name = lib.name();
+        for( std::size_t i=0; i<sections_count; ++i )
            {
-            f<< ind << "<struct name=\""sv << strct.name() << "\" version=\"1.0.0\">\n"sv;
-            f<< ind << "\t<descr>"sv << strct.descr() << "</descr>\n"sv;
-            f<< ind << "\t<vars>\n"sv;
-            for( const auto& var : strct.members() )
+            const auto sect = static_cast<Section>(i);
+            if( has_content(lib, sect) )
                {
-                f<< ind << "\t\t<var name=\""sv << var.name() << "\" type=\""sv << var.type() << "\">\n"sv
-                 << ind << "\t\t\t<descr>"sv << var.descr() << "</descr>\n"sv
-                 << ind << "\t\t</var>\n"sv;
+                sys::string_write content;
+                write_section_content(content, lib, sect);
+                part.sections[i] = content.take();
                }
-            f<< ind << "\t</vars>\n"sv;
-            f<< ind << "\t<iecDeclaration active=\"FALSE\"/>\n"sv;
-            f<< ind << "</struct>\n"sv;
            }
-        f<< "\t\t</structs>\n"sv;
-       }
-    else
-       {
-        f<< "\t\t<structs/>\n"sv;
+        return part;
        }
 
-    // [Typedefs]
-    if( !lib.typedefs().empty() )
+    //-----------------------------------------------------------------------
+    void add(const Part& part)
        {
-        f<< "\t\t<typedefs>\n"sv;
-        for( const auto& tdef : lib.typedefs() )
+        for( std::size_t i=0; i<sections_count; ++i )
            {
-            f<< ind << "<typedef name=\""sv << tdef.name() << "\" type=\""sv << tdef.type() << '\"';
-            if( tdef.has_length() ) f<< " length=\""sv << std::to_string(tdef.length()) << '\"';
-            if( tdef.is_array() )
-               {
-                if( tdef.array_startidx()!=0u ) throw std::runtime_error(fmt::format("plclib doesn't support arrays with a not null start index in typedef {}",tdef.name()));
-                f<< " dim0=\""sv << std::to_string(tdef.array_dim()) << '\"';
-               }
-            f<< ">\n"sv;
-            f<< ind << "\t<iecDeclaration active=\"FALSE\"/>\n"sv;
-            f<< ind << "\t<descr>"sv << tdef.descr() << "</descr>\n"sv;
-            f<< ind << "</typedef>\n"sv;
+            if( !part.sections[i].empty() ) i_sections[i] << part.sections[i];
            }
-        f<< "\t\t</typedefs>\n"sv;
-       }
-    else
-       {
-        f<< "\t\t<typedefs/>\n"sv;
+        i_libs.push_back( part.lib_name );
        }
 
-    // [Enums]
-    if( !lib.enums().empty() )
+    //-----------------------------------------------------------------------
+    void close(const str::keyvals& options)
        {
-        f<< "\t\t<enums>\n"sv;
-        for( const auto& en : lib.enums() )
+        sys::file_write f(i_path);
+        const std::string name{ fs::path(i_path).stem().string() };
+        write_heading(f, name, "1.0.0"sv, fmt::format("Combined {} libraries"sv, i_libs.size()), options);
+        f << "\t\t<!--\n"sv;
+        for( const auto& lib_name : i_libs ) f<< "\t\t\tlibrary: "sv << lib_name << '\n';
+        f << "\t\t-->\n"sv;
+
+        for( std::size_t i=0; i<sections_count; ++i )
            {
-            f<< ind << "<enum name=\""sv << en.name() << "\" version=\"1.0.0\">\n"sv;
-            f<< ind << "\t<descr>"sv << en.descr() << "</descr>\n"sv;
-            f<< ind << "\t<elements>\n"sv;
-            for( const auto& elem : en.elements() )
+            const auto sect = static_cast<Section>(i);
+            if( !i_sections[i].is_empty() )
+               {
+                write_section_open(f, sect);
+                i_sections[i].copy_to(f);
+                write_section_close(f, sect);
+               }
+            else
                {
-                f<< ind << "\t\t<element name=\""sv << elem.name() << "\">\n"sv
-                 << ind << "\t\t\t<descr>"sv << elem.descr() << "</descr>\n"sv
-                 << ind << "\t\t\t<value>"sv << elem.value() << "</value>\n"sv
-                 << ind << "\t\t</element>\n"sv;
+                write_section_empty(f, sect);
                }
-            f<< ind << "\t</elements>\n"sv;
-            f<< ind << "\t<iecDeclaration active=\"FALSE\"/>\n"sv;
-            f<< ind << "</enum>\n"sv;
            }
-        f<< "\t\t</enums>\n"sv;
-       }
-    else
-       {
-        f<< "\t\t<enums/>\n"sv;
-       }
 
-    // [Subranges]
-    if( !lib.subranges().empty() )
-       {
-        f<< "\t\t<subranges>\n"sv;
-        for( const auto& subr : lib.subranges() )
-           {
-            f<< ind << "<subrange name=\""sv << subr.name() << "\" version=\"1.0.0\" type=\""sv << subr.type() << "\">\n"sv;
-            //f<< ind << "\t<title>"sv << subr.title() << "</title>\n"sv;
-            f<< ind << "\t<descr>"sv << subr.descr() << "</descr>\n"sv;
-            f<< ind << "\t<minValue>"sv << std::to_string(subr.min_value()) << "</minValue>\n"sv;
-            f<< ind << "\t<maxValue>"sv << std::to_string(subr.max_value()) << "</maxValue>\n"sv;
-            f<< ind << "\t<iecDeclaration active=\"FALSE\"/>\n"sv;
-            f<< ind << "</subrange>\n"sv;
-           }
-        f<< "\t\t</subranges>\n"sv;
-       }
-    else
-       {
-        f<< "\t\t<subranges/>\n"sv;
+        write_closing(f);
+        f.close();
        }
 
-    // [Interfaces]
-    //if( !lib.interfaces().empty() )
-    //   {
-    //    f<< "\t\t<interfaces>\n"sv;
-    //    for( const auto& intfc : lib.interfaces() ) write(f, intfc, "interface"sv);
-    //    f<< "\t\t</interfaces>\n"sv;
-    //   }
-    //else
-    //   {
-          f<< "\t\t<interfaces/>\n"sv;
-    //   }
-
-    // [Closing]
-    f<< "\t</lib>\n"sv
-     << "</plcLibrary>\n"sv;
-}
+ private:
+    std::string i_path;
+    std::array<sys::temp_write, sections_count> i_sections;
+    std::vector<std::string> i_libs;
+};
 
 
 }//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
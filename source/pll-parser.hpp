@@ -9,7 +9,6 @@
 
     DEPENDENCIES:
     --------------------------------------------- */
-#include <cctype> // std::isdigit, std::isblank, ...
 #include <cmath> // std::pow, ...
 #include <string_view>
 //#include <limits> // std::numeric_limits
@@ -67,7 +66,7 @@ class Parser final : public BasicParser
                     // Get key
                     while( j<j_end && is_blank(buf[j]) ) ++j; // Skip blanks
                     std::size_t j_start = j;
-                    while( j<j_end && std::isalnum(buf[j]) ) ++j;
+                    while( j<j_end && ascii::is_alnum(buf[j]) ) ++j;
                     const std::string_view key(buf+j_start, j-j_start);
                     if( !key.empty() )
                        {
@@ -112,65 +111,114 @@ class Parser final : public BasicParser
            {
             skip_block_comment();
            }
-        else if( eat_token("PROGRAM"sv) )
-           {
-            //DBGLOG("Found PROGRAM in line {}\n", line)
-            auto& prg = lib.programs().emplace_back();
-            collect_pou(prg, "PROGRAM"sv, "END_PROGRAM"sv);
-           }
-        else if( eat_token("FUNCTION_BLOCK"sv) )
-           {
-            //DBGLOG("Found FUNCTION_BLOCK in line {}\n", line)
-            auto& fb = lib.function_blocks().emplace_back();
-            collect_pou(fb, "FUNCTION_BLOCK"sv, "END_FUNCTION_BLOCK"sv);
-           }
-        else if( eat_token("FUNCTION"sv) )
-           {
-            //DBGLOG("Found FUNCTION in line {}\n", line)
-            auto& fn = lib.functions().emplace_back();
-            collect_pou(fn, "FUNCTION"sv, "END_FUNCTION"sv, true);
-           }
-        else if( eat_token("MACRO"sv) )
-           {
-            //DBGLOG("Found MACRO in line {}\n", line)
-            auto& macro = lib.macros().emplace_back();
-            collect_macro(macro);
-           }
-        else if( eat_token("TYPE"sv) )
-           {// struct/typdef/enum/subrange
-            //DBGLOG("Found TYPE in line {}\n", line)
-            collect_type(lib);
-           }
-        else if( eat_token("VAR_GLOBAL"sv) )
+        else
            {
-            //DBGLOG("Found VAR_GLOBAL in line {}\n", line)
-            // Check if there's some additional attributes
-            skip_blanks();
-            if( eat_token("CONSTANT"sv) )
-               {
-                collect_global_vars( lib.global_constants().groups(), true );
-               }
-            else if( eat_token("RETAIN"sv) )
-               {
-                notify_error("RETAIN variables not supported");
-               }
-            else if( eat_line_end() )
-               {
-                collect_global_vars( lib.global_variables().groups() );
-               }
-            else
+            const std::size_t i_start = i;
+            switch( eat_keyword() )
                {
-                throw create_parse_error(fmt::format("Unexpected content in VAR_GLOBAL declaration: {}", str::escape(skip_line())));
+                case Keyword::PROGRAM :
+                   {
+                    //DBGLOG("Found PROGRAM in line {}\n", curr_line())
+                    auto& prg = lib.programs().emplace_back();
+                    collect_pou(prg, "PROGRAM"sv, "END_PROGRAM"sv);
+                   } break;
+
+                case Keyword::FUNCTION_BLOCK :
+                   {
+                    //DBGLOG("Found FUNCTION_BLOCK in line {}\n", curr_line())
+                    auto& fb = lib.function_blocks().emplace_back();
+                    collect_pou(fb, "FUNCTION_BLOCK"sv, "END_FUNCTION_BLOCK"sv);
+                   } break;
+
+                case Keyword::FUNCTION :
+                   {
+                    //DBGLOG("Found FUNCTION in line {}\n", curr_line())
+                    auto& fn = lib.functions().emplace_back();
+                    collect_pou(fn, "FUNCTION"sv, "END_FUNCTION"sv, true);
+                   } break;
+
+                case Keyword::MACRO :
+                   {
+                    //DBGLOG("Found MACRO in line {}\n", curr_line())
+                    auto& macro = lib.macros().emplace_back();
+                    collect_macro(macro);
+                   } break;
+
+                case Keyword::TYPE :
+                    // struct/typdef/enum/subrange
+                    //DBGLOG("Found TYPE in line {}\n", curr_line())
+                    collect_type(lib);
+                    break;
+
+                case Keyword::VAR_GLOBAL :
+                    //DBGLOG("Found VAR_GLOBAL in line {}\n", curr_line())
+                    // Check if there's some additional attributes
+                    skip_blanks();
+                    if( eat_token("CONSTANT"sv) )
+                       {
+                        collect_global_vars( lib.global_constants().groups(), true );
+                       }
+                    else if( eat_token("RETAIN"sv) )
+                       {
+                        notify_error("RETAIN variables not supported");
+                       }
+                    else if( eat_line_end() )
+                       {
+                        collect_global_vars( lib.global_variables().groups() );
+                       }
+                    else
+                       {
+                        throw create_parse_error(fmt::format("Unexpected content in VAR_GLOBAL declaration: {}", str::escape(skip_line())));
+                       }
+                    break;
+
+                default :
+                    i = i_start; // Not expected here
+                    if( eat_token("VAR_GLOBAL"sv) )
+                       {// Unsupported global variables block, its content can't be skipped
+                        throw create_parse_error(fmt::format("Unexpected content in VAR_GLOBAL declaration: {}", str::escape(skip_line())));
+                       }
+                    notify_error("Unexpected content: {}", str::escape(skip_line()));
                }
            }
-        else
-           {
-            notify_error("Unexpected content: {}", str::escape(skip_line()));
-           }
        }
 
 
  private:
+    enum class Keyword : std::uint8_t
+       {
+        none, // Not a keyword
+        PROGRAM,
+        FUNCTION_BLOCK,
+        FUNCTION,
+        MACRO,
+        TYPE,
+        VAR_GLOBAL,
+        VAR,
+        VAR_INPUT,
+        VAR_OUTPUT,
+        VAR_IN_OUT,
+        VAR_EXTERNAL
+       };
+    static constexpr Keywords<Keyword,11> keywords{{{ {"PROGRAM"sv, Keyword::PROGRAM},
+                                                      {"FUNCTION_BLOCK"sv, Keyword::FUNCTION_BLOCK},
+                                                      {"FUNCTION"sv, Keyword::FUNCTION},
+                                                      {"MACRO"sv, Keyword::MACRO},
+                                                      {"TYPE"sv, Keyword::TYPE},
+                                                      {"VAR_GLOBAL"sv, Keyword::VAR_GLOBAL},
+                                                      {"VAR"sv, Keyword::VAR},
+                                                      {"VAR_INPUT"sv, Keyword::VAR_INPUT},
+                                                      {"VAR_OUTPUT"sv, Keyword::VAR_OUTPUT},
+                                                      {"VAR_IN_OUT"sv, Keyword::VAR_IN_OUT},
+                                                      {"VAR_EXTERNAL"sv, Keyword::VAR_EXTERNAL} }}};
+
+    //-----------------------------------------------------------------------
+    // Scan a whole identifier and recognize it with a single lookup,
+    // so the keywords sharing a prefix don't depend on the order
+    [[nodiscard]] Keyword eat_keyword() noexcept
+       {
+        return keywords.find( collect_identifier() );
+       }
 
     //-----------------------------------------------------------------------
     [[nodiscard]] bool eat_block_comment_start() noexcept
@@ -187,22 +235,14 @@ class Parser final : public BasicParser
     //-----------------------------------------------------------------------
     void skip_block_comment()
        {
-        const std::size_t line_start = line; // Store current line
         const std::size_t i_start = i; // Store current position
-        while( i<i_last )
+        i = scan::find_pair(buf, i, siz, '*', ')');
+        if( i<siz )
            {
-            if( buf[i]=='*' && buf[i+1]==')' )
-               {
-                i += 2; // Skip "*)"
-                return;
-               }
-            else if( buf[i]=='\n' )
-               {
-                ++line;
-               }
-            ++i;
+            i += 2; // Skip "*)"
+            return;
            }
-        throw create_parse_error("Unclosed block comment", line_start, i_start);
+        throw create_parse_error("Unclosed block comment", i_start);
        }
 
 
@@ -711,57 +751,67 @@ class Parser final : public BasicParser
                         notify_error("Unexpected directive \"{}\" in {} {}", dir.key(), start_tag, pou.name());
                        }
                    }
-                else if( eat_token("VAR_INPUT"sv) )
-                   {
-                    check_if_line_ended_after("VAR_INPUT of {}"sv, pou.name());
-                    collect_var_block( pou.input_vars() );
-                   }
-                else if( eat_token("VAR_OUTPUT"sv) )
-                   {
-                    check_if_line_ended_after("VAR_OUTPUT of {}"sv, pou.name());
-                    collect_var_block( pou.output_vars() );
-                   }
-                else if( eat_token("VAR_IN_OUT"sv) )
-                   {
-                    check_if_line_ended_after("VAR_IN_OUT of {}"sv, pou.name());
-                    collect_var_block( pou.inout_vars() );
-                   }
-                else if( eat_token("VAR_EXTERNAL"sv) )
-                   {
-                    check_if_line_ended_after("VAR_EXTERNAL of {}"sv, pou.name());
-                    collect_var_block( pou.external_vars() );
-                   }
-                else if( eat_token("VAR"sv) )
+                else
                    {
-                    // Check if there's some additional attributes
-                    skip_blanks();
-                    if( eat_token("CONSTANT"sv) )
-                       {
-                        check_if_line_ended_after("VAR CONSTANT of {}"sv, pou.name());
-                        collect_var_block( pou.local_constants(), true );
-                       }
-                    //else if( eat_token("RETAIN"sv) )
-                    //   {
-                    //    notify_error("RETAIN variables not supported");
-                    //   }
-                    else if( eat_line_end() )
-                       {
-                        collect_var_block( pou.local_vars() );
-                       }
-                    else
+                    const std::size_t i_start = i;
+                    switch( eat_keyword() )
                        {
-                        throw create_parse_error(fmt::format("Unexpected content after VAR of {} {}: {}", start_tag, pou.name(), str::escape(skip_line())));
+                        case Keyword::VAR_INPUT :
+                            check_if_line_ended_after("VAR_INPUT of {}"sv, pou.name());
+                            collect_var_block( pou.input_vars() );
+                            break;
+
+                        case Keyword::VAR_OUTPUT :
+                            check_if_line_ended_after("VAR_OUTPUT of {}"sv, pou.name());
+                            collect_var_block( pou.output_vars() );
+                            break;
+
+                        case Keyword::VAR_IN_OUT :
+                            check_if_line_ended_after("VAR_IN_OUT of {}"sv, pou.name());
+                            collect_var_block( pou.inout_vars() );
+                            break;
+
+                        case Keyword::VAR_EXTERNAL :
+                            check_if_line_ended_after("VAR_EXTERNAL of {}"sv, pou.name());
+                            collect_var_block( pou.external_vars() );
+                            break;
+
+                        case Keyword::VAR :
+                            // Check if there's some additional attributes
+                            skip_blanks();
+                            if( eat_token("CONSTANT"sv) )
+                               {
+                                check_if_line_ended_after("VAR CONSTANT of {}"sv, pou.name());
+                                collect_var_block( pou.local_constants(), true );
+                               }
+                            //else if( eat_token("RETAIN"sv) )
+                            //   {
+                            //    notify_error("RETAIN variables not supported");
+                            //   }
+                            else if( eat_line_end() )
+                               {
+                                collect_var_block( pou.local_vars() );
+                               }
+                            else
+                               {
+                                throw create_parse_error(fmt::format("Unexpected content after VAR of {} {}: {}", start_tag, pou.name(), str::escape(skip_line())));
+                               }
+                            break;
+
+                        default :
+                            i = i_start; // Not expected here
+                            if( eat_token(end_tag) )
+                               {
+                                notify_error("Truncated {} {}", start_tag, pou.name());
+                                return;
+                               }
+                            if( eat_token("VAR"sv) )
+                               {// Unsupported variables block (ex. VAR_TEMP), its content can't be skipped
+                                throw create_parse_error(fmt::format("Unexpected content after VAR of {} {}: {}", start_tag, pou.name(), str::escape(skip_line())));
+                               }
+                            notify_error("Unexpected content in {} {} header: {}", start_tag, pou.name(), str::escape(skip_line()));
                        }
                    }
-                else if( eat_token(end_tag) )
-                   {
-                    notify_error("Truncated {} {}", start_tag, pou.name());
-                    break;
-                   }
-                else
-                   {
-                    notify_error("Unexpected content in {} {} header: {}", start_tag, pou.name(), str::escape(skip_line()));
-                   }
                }
            }
        }
@@ -13,7 +13,6 @@
 #include <string_view>
 #include <cstdint> // uint16_t, uint32_t
 #include <limits> // std::numeric_limits
-#include <cctype> // std::isdigit
 //#include <type_traits> // std::enable_if, std::is_unsigned
 #include <stdexcept> // std::exception, std::runtime_error, ...
 #include <fmt/core.h> // fmt::format
@@ -54,7 +53,7 @@ namespace pll
 
 //---------------------------------------------------------------------------
 // Write variable to pll file
-inline void write(const sys::file_write& f, const plcb::Variable& var)
+template<typename W> inline void write(W& f, const plcb::Variable& var)
 {
     assert( !var.name().empty() );
 
@@ -101,7 +100,7 @@ inline void write(const sys::file_write& f, const plcb::Variable& var)
 
 //---------------------------------------------------------------------------
 // Write POU to pll file
-inline void write(const sys::file_write& f, const plcb::Pou& pou, const std::string_view tag)
+template<typename W> inline void write(W& f, const plcb::Pou& pou, const std::string_view tag)
 {
     f << '\n' << tag << ' ' << pou.name();
     if( pou.has_return_type() )
@@ -155,7 +154,7 @@ inline void write(const sys::file_write& f, const plcb::Pou& pou, const std::str
 
     // [Body]
     f << "\n\t{ CODE:"sv << pou.code_type() << " }"sv
-      << pou.body();
+      << sys::lasting_view{pou.body()};
     if( !pou.body().ends_with('\n') ) f << '\n';
     f << "END_"sv << tag << "\n\n"sv;
 }
@@ -163,7 +162,7 @@ inline void write(const sys::file_write& f, const plcb::Pou& pou, const std::str
 
 //---------------------------------------------------------------------------
 // Write macro to plclib file
-inline void write(const sys::file_write& f, const plcb::Macro& macro)
+template<typename W> inline void write(W& f, const plcb::Macro& macro)
 {
     f << "\nMACRO "sv << macro.name() << '\n';
 
@@ -185,43 +184,19 @@ inline void write(const sys::file_write& f, const plcb::Macro& macro)
 
     // [Body]
     f << "\n\t{ CODE:"sv << macro.code_type() << " }"sv
-      << macro.body();
+      << sys::lasting_view{macro.body()};
     if( !macro.body().ends_with('\n') ) f << '\n';
     f << "END_MACRO\n\n"sv;
 }
 
 
 //---------------------------------------------------------------------------
-// Write library to pll file
-void write(const sys::file_write& f, const plcb::Library& lib, [[maybe_unused]] const str::keyvals& options)
+// Write the sections of a library, after the heading
+template<typename W> void write_sections(W& f, const plcb::Library& lib)
 {
-    // [Options]
-    //auto xxx = options.value_of("xxx");
     const std::string_view sects_spacer = "\n\n\n"sv;
     const std::string_view blocks_spacer = "\n\n"sv;
 
-    // [Heading]
-    f<< "(*\n"sv
-     << "\tname: "sv << lib.name() << '\n'
-     << "\tdescr: "sv << lib.descr() << '\n'
-     << "\tversion: "sv << lib.version() << '\n'
-     << "\tauthor: llconv pll::write()\n"sv
-     << "\tdate: "sv << sys::human_readable_time_stamp() << "\n\n"sv;
-    // Content summary
-    if( !lib.global_variables().is_empty() )  f<< "\tglobal-variables: "sv << std::to_string(lib.global_variables().size())  << '\n';
-    if( !lib.global_constants().is_empty() )  f<< "\tglobal-constants: "sv << std::to_string(lib.global_constants().size())  << '\n';
-    if( !lib.global_retainvars().is_empty() ) f<< "\tglobal-retain-vars: "sv << std::to_string(lib.global_retainvars().size())  << '\n';
-    if( !lib.functions().empty() )            f<< "\tfunctions: "sv << std::to_string(lib.functions().size())  << '\n';
-    if( !lib.function_blocks().empty() )      f<< "\tfunction blocks: "sv << std::to_string(lib.function_blocks().size())  << '\n';
-    if( !lib.programs().empty() )             f<< "\tprograms: "sv << std::to_string(lib.programs().size())  << '\n';
-    if( !lib.macros().empty() )               f<< "\tmacros: "sv << std::to_string(lib.macros().size())  << '\n';
-    if( !lib.structs().empty() )              f<< "\tstructs: "sv << std::to_string(lib.structs().size())  << '\n';
-    if( !lib.typedefs().empty() )             f<< "\ttypedefs: "sv << std::to_string(lib.typedefs().size())  << '\n';
-    if( !lib.enums().empty() )                f<< "\tenums: "sv << std::to_string(lib.enums().size())  << '\n';
-    if( !lib.subranges().empty() )            f<< "\tsubranges: "sv << std::to_string(lib.subranges().size())  << '\n';
-    //if( !lib.interfaces().empty() )           f<< "\tinterfaces: "sv << std::to_string(lib.interfaces().size())  << '\n';
-    f << "*)\n"sv;
-
     // [Global variables]
     if( !lib.global_variables().is_empty() ||
         !lib.global_retainvars().is_empty() )
@@ -465,6 +440,85 @@ void write(const sys::file_write& f, const plcb::Library& lib, [[maybe_unused]]
 }
 
 
+//---------------------------------------------------------------------------
+// Write library to pll file
+template<typename W> void write(W& f, const plcb::Library& lib, [[maybe_unused]] const str::keyvals& options)
+{
+    // [Options]
+    //auto xxx = options.value_of("xxx");
+
+    // [Heading]
+    f<< "(*\n"sv
+     << "\tname: "sv << lib.name() << '\n'
+     << "\tdescr: "sv << lib.descr() << '\n'
+     << "\tversion: "sv << lib.version() << '\n'
+     << "\tauthor: llconv pll::write()\n"sv
+     << "\tdate: "sv << sys::human_readable_time_stamp() << "\n\n"sv;
+    // Content summary
+    if( !lib.global_variables().is_empty() )  f<< "\tglobal-variables: "sv << std::to_string(lib.global_variables().size())  << '\n';
+    if( !lib.global_constants().is_empty() )  f<< "\tglobal-constants: "sv << std::to_string(lib.global_constants().size())  << '\n';
+    if( !lib.global_retainvars().is_empty() ) f<< "\tglobal-retain-vars: "sv << std::to_string(lib.global_retainvars().size())  << '\n';
+    if( !lib.functions().empty() )            f<< "\tfunctions: "sv << std::to_string(lib.functions().size())  << '\n';
+    if( !lib.function_blocks().empty() )      f<< "\tfunction blocks: "sv << std::to_string(lib.function_blocks().size())  << '\n';
+    if( !lib.programs().empty() )             f<< "\tprograms: "sv << std::to_string(lib.programs().size())  << '\n';
+    if( !lib.macros().empty() )               f<< "\tmacros: "sv << std::to_string(lib.macros().size())  << '\n';
+    if( !lib.structs().empty() )              f<< "\tstructs: "sv << std::to_string(lib.structs().size())  << '\n';
+    if( !lib.typedefs().empty() )             f<< "\ttypedefs: "sv << std::to_string(lib.typedefs().size())  << '\n';
+    if( !lib.enums().empty() )                f<< "\tenums: "sv << std::to_string(lib.enums().size())  << '\n';
+    if( !lib.subranges().empty() )            f<< "\tsubranges: "sv << std::to_string(lib.subranges().size())  << '\n';
+    //if( !lib.interfaces().empty() )           f<< "\tinterfaces: "sv << std::to_string(lib.interfaces().size())  << '\n';
+    f << "*)\n"sv;
+
+    write_sections(f, lib);
+}
+
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Several libraries combined in a single pll file: sections can
+// be repeated, so each library is appended as soon as it comes
+class CombinedWriter final
+{
+ public:
+    explicit CombinedWriter(const std::string& pth)
+      : i_file(pth)
+       {
+        i_file<< "(*\n"sv
+              << "\tname: "sv << fs::path(pth).stem().string() << '\n'
+              << "\tdescr: Combined libraries\n"sv
+              << "\tversion: 1.0.0\n"sv
+              << "\tauthor: llconv pll::write()\n"sv
+              << "\tdate: "sv << sys::human_readable_time_stamp() << '\n'
+              << "*)\n"sv;
+       }
+
+    //-----------------------------------------------------------------------
+    // The library content, ready to be added
+    [[nodiscard]] static std::string render(const plcb::Library& lib)
+       {
+        sys::string_write part;
+        part<< "\n\n\n(* library: "sv << lib.name() << " *)\n"sv;
+        write_sections(part, lib);
+        return part.take();
+       }
+
+    //-----------------------------------------------------------------------
+    void add(const std::string_view part)
+       {
+        i_file << part;
+       }
+
+    //-----------------------------------------------------------------------
+    void close()
+       {
+        i_file.close();
+       }
+
+ private:
+    sys::file_write i_file;
+};
+
+
 }//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
 
 
@@ -0,0 +1,226 @@
+#ifndef GUARD_simd_scan_hpp
+#define GUARD_simd_scan_hpp
+/*  ---------------------------------------------
+    ©2022 matteo.gattanini@gmail.com
+
+    OVERVIEW
+    ---------------------------------------------
+    Scanning of text buffers classifying a block
+    of characters at each step (AVX2, SSE2, NEON)
+    with a scalar fallback for the tail and the
+    other architectures
+
+    CONSTRAINTS
+    ---------------------------------------------
+    Classes of the "C" locale, no multibyte chars
+
+    DEPENDENCIES:
+    --------------------------------------------- */
+#include <cstdint> // std::uint64_t
+#include <cstring> // std::memchr
+#include <bit> // std::countr_zero
+
+#include "ascii.hpp" // ascii::*
+
+#if defined(__AVX2__)
+  #define SCAN_AVX2
+  #include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP>=2)
+  #define SCAN_SSE2
+  #include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+  #define SCAN_NEON
+  #include <arm_neon.h>
+#endif
+
+
+//:::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+namespace scan //::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+{
+
+//:::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+namespace vec //:::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+{
+// The operations on a block of characters: each class (the
+// same of 'ascii') becomes a mask of 'bits_per_char' per char
+
+#if defined(SCAN_AVX2)
+    using block_t = __m256i;
+    inline constexpr std::size_t block_size = 32;
+    inline constexpr int bits_per_char = 1;
+
+    [[nodiscard]] inline block_t load(const char* const p) noexcept { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+    [[nodiscard]] inline block_t eq(const block_t v, const char c) noexcept { return _mm256_cmpeq_epi8(v, _mm256_set1_epi8(c)); }
+    [[nodiscard]] inline block_t either(const block_t a, const block_t b) noexcept { return _mm256_or_si256(a, b); }
+    [[nodiscard]] inline block_t both(const block_t a, const block_t b) noexcept { return _mm256_and_si256(a, b); }
+    [[nodiscard]] inline block_t but(const block_t a, const block_t b) noexcept { return _mm256_andnot_si256(b, a); }
+    [[nodiscard]] inline block_t lowercase(const block_t v) noexcept { return _mm256_or_si256(v, _mm256_set1_epi8(0x20)); }
+    [[nodiscard]] inline block_t in_range(const block_t v, const char lo, const char hi) noexcept
+       {// Unsigned (v-lo) <= (hi-lo)
+        const block_t d = _mm256_sub_epi8(v, _mm256_set1_epi8(lo));
+        return _mm256_cmpeq_epi8(_mm256_min_epu8(d, _mm256_set1_epi8(static_cast<char>(hi-lo))), d);
+       }
+    [[nodiscard]] inline std::uint64_t mask(const block_t m) noexcept { return static_cast<std::uint32_t>(_mm256_movemask_epi8(m)); }
+    inline constexpr std::uint64_t all_set = 0xFFFFFFFFull;
+
+#elif defined(SCAN_SSE2)
+    using block_t = __m128i;
+    inline constexpr std::size_t block_size = 16;
+    inline constexpr int bits_per_char = 1;
+
+    [[nodiscard]] inline block_t load(const char* const p) noexcept { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+    [[nodiscard]] inline block_t eq(const block_t v, const char c) noexcept { return _mm_cmpeq_epi8(v, _mm_set1_epi8(c)); }
+    [[nodiscard]] inline block_t either(const block_t a, const block_t b) noexcept { return _mm_or_si128(a, b); }
+    [[nodiscard]] inline block_t both(const block_t a, const block_t b) noexcept { return _mm_and_si128(a, b); }
+    [[nodiscard]] inline block_t but(const block_t a, const block_t b) noexcept { return _mm_andnot_si128(b, a); }
+    [[nodiscard]] inline block_t lowercase(const block_t v) noexcept { return _mm_or_si128(v, _mm_set1_epi8(0x20)); }
+    [[nodiscard]] inline block_t in_range(const block_t v, const char lo, const char hi) noexcept
+       {// Unsigned (v-lo) <= (hi-lo)
+        const block_t d = _mm_sub_epi8(v, _mm_set1_epi8(lo));
+        return _mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8(static_cast<char>(hi-lo))), d);
+       }
+    [[nodiscard]] inline std::uint64_t mask(const block_t m) noexcept { return static_cast<std::uint32_t>(_mm_movemask_epi8(m)); }
+    inline constexpr std::uint64_t all_set = 0xFFFFull;
+
+#elif defined(SCAN_NEON)
+    using block_t = uint8x16_t;
+    inline constexpr std::size_t block_size = 16;
+    inline constexpr int bits_per_char = 4;
+
+    [[nodiscard]] inline block_t load(const char* const p) noexcept { return vld1q_u8(reinterpret_cast<const std::uint8_t*>(p)); }
+    [[nodiscard]] inline block_t eq(const block_t v, const char c) noexcept { return vceqq_u8(v, vdupq_n_u8(static_cast<std::uint8_t>(c))); }
+    [[nodiscard]] inline block_t either(const block_t a, const block_t b) noexcept { return vorrq_u8(a, b); }
+    [[nodiscard]] inline block_t both(const block_t a, const block_t b) noexcept { return vandq_u8(a, b); }
+    [[nodiscard]] inline block_t but(const block_t a, const block_t b) noexcept { return vbicq_u8(a, b); }
+    [[nodiscard]] inline block_t lowercase(const block_t v) noexcept { return vorrq_u8(v, vdupq_n_u8(0x20)); }
+    [[nodiscard]] inline block_t in_range(const block_t v, const char lo, const char hi) noexcept
+       {// Unsigned (v-lo) <= (hi-lo)
+        return vcleq_u8(vsubq_u8(v, vdupq_n_u8(static_cast<std::uint8_t>(lo))), vdupq_n_u8(static_cast<std::uint8_t>(hi-lo)));
+       }
+    [[nodiscard]] inline std::uint64_t mask(const block_t m) noexcept
+       {// A nibble per char, no 'movemask' in NEON
+        return vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(m), 4)), 0);
+       }
+    inline constexpr std::uint64_t all_set = ~0ull;
+#endif
+
+#if defined(SCAN_AVX2) || defined(SCAN_SSE2) || defined(SCAN_NEON)
+    #define SCAN_VECTORIZED
+
+    [[nodiscard]] inline block_t space(const block_t v) noexcept
+       {
+        return either(in_range(v, '\t', '\r'), eq(v, ' '));
+       }
+
+    [[nodiscard]] inline block_t blank(const block_t v) noexcept
+       {
+        return but(space(v), eq(v, '\n'));
+       }
+
+    [[nodiscard]] inline block_t ident(const block_t v) noexcept
+       {
+        return either(either(in_range(lowercase(v), 'a', 'z'), in_range(v, '0', '9')), eq(v, '_'));
+       }
+
+    //-----------------------------------------------------------------------
+    // Advance the index by blocks while no char is in the mask
+    // of the block at 'p', leaving it on the first one or on the tail
+    template<typename F> [[nodiscard]] inline std::size_t first_of(const char* const buf, std::size_t i, const std::size_t siz, F&& stop_mask) noexcept
+       {
+        while( i+block_size<=siz )
+           {
+            if( const std::uint64_t m = stop_mask(buf+i); m!=0 )
+               {
+                return i + static_cast<std::size_t>(std::countr_zero(m) / bits_per_char);
+               }
+            i += block_size;
+           }
+        return i;
+       }
+#endif
+}//:::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+
+//---------------------------------------------------------------------------
+// Index of the first char not blank from 'i', 'siz' if none
+[[nodiscard]] inline std::size_t skip_blanks(const char* const buf, std::size_t i, const std::size_t siz) noexcept
+{
+  #ifdef SCAN_VECTORIZED
+    i = vec::first_of(buf, i, siz, [](const char* const p) noexcept { return ~vec::mask(vec::blank(vec::load(p))) & vec::all_set; });
+  #endif
+    while( i<siz && ascii::is_blank(buf[i]) ) ++i;
+    return i;
+}
+
+
+//---------------------------------------------------------------------------
+// Index of the first char not of an identifier from 'i', 'siz' if none
+[[nodiscard]] inline std::size_t skip_identifier(const char* const buf, std::size_t i, const std::size_t siz) noexcept
+{
+  #ifdef SCAN_VECTORIZED
+    i = vec::first_of(buf, i, siz, [](const char* const p) noexcept { return ~vec::mask(vec::ident(vec::load(p))) & vec::all_set; });
+  #endif
+    while( i<siz && ascii::is_ident(buf[i]) ) ++i;
+    return i;
+}
+
+
+//---------------------------------------------------------------------------
+// Index of the first space char from 'i', 'siz' if none
+[[nodiscard]] inline std::size_t find_space(const char* const buf, std::size_t i, const std::size_t siz) noexcept
+{
+  #ifdef SCAN_VECTORIZED
+    i = vec::first_of(buf, i, siz, [](const char* const p) noexcept { return vec::mask(vec::space(vec::load(p))); });
+  #endif
+    while( i<siz && !ascii::is_space(buf[i]) ) ++i;
+    return i;
+}
+
+
+//---------------------------------------------------------------------------
+// Index of the first 'c1' or 'c2' from 'i', 'siz' if none
+[[nodiscard]] inline std::size_t find_either(const char* const buf, std::size_t i, const std::size_t siz, const char c1, const char c2) noexcept
+{
+  #ifdef SCAN_VECTORIZED
+    i = vec::first_of(buf, i, siz, [c1, c2](const char* const p) noexcept { const vec::block_t v = vec::load(p); return vec::mask(vec::either(vec::eq(v, c1), vec::eq(v, c2))); });
+  #endif
+    while( i<siz && buf[i]!=c1 && buf[i]!=c2 ) ++i;
+    return i;
+}
+
+
+//---------------------------------------------------------------------------
+// Index of the first 'c1' followed by 'c2' from 'i', 'siz' if none.
+// Comparing a block with the one shifted by a char, a run of 'c1'
+// (think of a banner comment) doesn't stop the scan at each char
+[[nodiscard]] inline std::size_t find_pair(const char* const buf, std::size_t i, const std::size_t siz, const char c1, const char c2) noexcept
+{
+    if( siz<2 ) return siz;
+  #ifdef SCAN_VECTORIZED
+    i = vec::first_of(buf, i, siz-1, [c1, c2](const char* const p) noexcept { return vec::mask(vec::both(vec::eq(vec::load(p), c1), vec::eq(vec::load(p+1), c2))); });
+  #endif
+    while( i<siz-1 )
+       {
+        if( buf[i]==c1 && buf[i+1]==c2 ) return i;
+        ++i;
+       }
+    return siz;
+}
+
+
+//---------------------------------------------------------------------------
+// Index of the first 'c' from 'i', 'siz' if none
+[[nodiscard]] inline std::size_t find(const char* const buf, const std::size_t i, const std::size_t siz, const char c) noexcept
+{
+    if( i>=siz ) return siz;
+    const void* const p = std::memchr(buf+i, c, siz-i); // Already vectorized
+    return p ? static_cast<std::size_t>(static_cast<const char*>(p) - buf) : siz;
+}
+
+
+}//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+
+
+//---- end unit -------------------------------------------------------------
+#endif
@@ -0,0 +1,342 @@
+#ifndef GUARD_stats_hpp
+#define GUARD_stats_hpp
+/*  ---------------------------------------------
+    ©2022 matteo.gattanini@gmail.com
+
+    OVERVIEW
+    ---------------------------------------------
+    Timing of the conversion phases, optionally
+    traced in Chrome Trace Event Format
+
+    DEPENDENCIES:
+    --------------------------------------------- */
+#include <cstdint> // std::uint8_t
+#include <array>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <chrono> // std::chrono::steady_clock
+#include <ostream> // std::ostream
+#include <mutex> // std::mutex, std::scoped_lock
+#include <atomic> // std::atomic
+#include <fmt/core.h> // fmt::format
+
+#include "system.hpp" // sys::file_write
+
+using namespace std::literals; // "..."sv
+
+
+//:::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+namespace stats //:::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+{
+
+//---------------------------------------------------------------------------
+enum class Phase : std::uint8_t
+{
+    map,
+    parse,
+    check,
+    sort,
+    write_pll,
+    write_plclib
+};
+inline constexpr std::size_t phases_count = 6;
+inline constexpr std::array<std::string_view, phases_count> phases_names = { "map"sv, "parse"sv, "check"sv, "sort"sv, "write-pll"sv, "write-plclib"sv };
+
+using clock_type = std::chrono::steady_clock;
+
+
+/////////////////////////////////////////////////////////////////////////////
+// What's collected about a converted file
+struct FileStats
+{
+    std::string name;
+    std::size_t bytes = 0; // Input size
+    std::size_t elements = 0; // Elements in the library
+    std::size_t written_bytes = 0; // Output size
+    std::size_t flushes = 0; // Write calls to the system
+    std::array<double, phases_count> seconds{}; // Spent in each phase
+
+    [[nodiscard]] double total_seconds() const noexcept
+       {
+        double tot = 0.0;
+        for( const double s : seconds ) tot += s;
+        return tot;
+       }
+
+    void accumulate(const FileStats& other) noexcept
+       {
+        bytes += other.bytes;
+        elements += other.elements;
+        written_bytes += other.written_bytes;
+        flushes += other.flushes;
+        for( std::size_t i=0; i<phases_count; ++i ) seconds[i] += other.seconds[i];
+       }
+};
+
+
+//---------------------------------------------------------------------------
+[[nodiscard]] std::string json_escape(const std::string_view s)
+{
+    std::string escaped;
+    escaped.reserve(s.size());
+    for( const char ch : s )
+       {
+        switch( ch )
+           {
+            case '\"': escaped += "\\\""sv; break;
+            case '\\': escaped += "\\\\"sv; break;
+            case '\n': escaped += "\\n"sv; break;
+            case '\r': escaped += "\\r"sv; break;
+            case '\t': escaped += "\\t"sv; break;
+            default:
+                if( static_cast<unsigned char>(ch)<0x20 ) escaped += fmt::format("\\u{:04x}"sv, static_cast<unsigned int>(ch));
+                else escaped += ch;
+           }
+       }
+    return escaped;
+}
+
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Collects the spans of a run to be viewed in chrome://tracing
+// or Perfetto. While existing, it's reachable through 'tracer'
+class Tracer;
+inline Tracer* tracer = nullptr; // Not null when tracing
+
+class Tracer final
+{
+ public:
+    Tracer() noexcept
+       {
+        tracer = this;
+        sys::io_trace = &add_io;
+       }
+
+    ~Tracer() noexcept
+       {
+        sys::io_trace = nullptr;
+        tracer = nullptr;
+       }
+
+    Tracer(const Tracer&) = delete;
+    Tracer(Tracer&&) = delete;
+    Tracer& operator=(const Tracer&) = delete;
+    Tracer& operator=(Tracer&&) = delete;
+
+    //-----------------------------------------------------------------------
+    // Can be called by any thread
+    void add(const std::string_view name, const std::string_view detail, const clock_type::time_point start, const clock_type::time_point end) noexcept
+       {
+        try{
+            const std::scoped_lock lock(i_mtx);
+            i_events.push_back( Event{ std::string(name), std::string(detail), thread_id(), start, end } );
+           }
+        catch(...) {} // Better lose an event than the conversion
+       }
+
+    //-----------------------------------------------------------------------
+    // Timestamps are in microseconds since the tracer creation
+    void write(const std::string& pth) const
+       {
+        auto us_since = [](const clock_type::time_point t0, const clock_type::time_point t) noexcept
+           {
+            return std::chrono::duration<double, std::micro>(t - t0).count();
+           };
+
+        // Copied, the writes of the trace file itself are traced
+        std::vector<Event> events;
+           {
+            const std::scoped_lock lock(i_mtx);
+            events = i_events;
+           }
+
+        sys::file_write f(pth);
+        f << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"sv;
+        f << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"llconv\"}}"sv;
+        for( const auto& ev : events )
+           {
+            f << fmt::format(",\n{{\"name\":\"{}\",\"cat\":\"llconv\",\"ph\":\"X\",\"pid\":1,\"tid\":{},\"ts\":{:.3f},\"dur\":{:.3f},\"args\":{{\"file\":\"{}\"}}}}"sv,
+                             json_escape(ev.name), ev.tid, us_since(i_t0, ev.start), us_since(ev.start, ev.end), json_escape(ev.detail));
+           }
+        f << "\n]}\n"sv;
+        f.close();
+       }
+
+ private:
+    struct Event
+       {
+        std::string name;
+        std::string detail;
+        unsigned int tid;
+        clock_type::time_point start;
+        clock_type::time_point end;
+       };
+
+    const clock_type::time_point i_t0 = clock_type::now();
+    mutable std::mutex i_mtx;
+    std::vector<Event> i_events;
+
+    //-----------------------------------------------------------------------
+    // Receives the single I/O operations (see 'sys::io_span')
+    static void add_io(const std::string_view name, const std::string_view detail, const clock_type::time_point start, const clock_type::time_point end) noexcept
+       {
+        if( tracer ) tracer->add(name, detail, start, end);
+       }
+
+    //-----------------------------------------------------------------------
+    // A small number for each thread
+    [[nodiscard]] static unsigned int thread_id() noexcept
+       {
+        static std::atomic<unsigned int> count{0};
+        thread_local const unsigned int id = ++count;
+        return id;
+       }
+};
+
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Trace an operation that's not a conversion phase
+class TraceSpan final
+{
+ public:
+    explicit TraceSpan(const std::string_view name, const std::string_view detail ={}) noexcept
+      : i_name(name)
+      , i_detail(detail)
+       {
+        if( tracer ) i_start = clock_type::now();
+       }
+
+    ~TraceSpan() noexcept
+       {
+        if( tracer ) tracer->add(i_name, i_detail, i_start, clock_type::now());
+       }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan(TraceSpan&&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+    TraceSpan& operator=(TraceSpan&&) = delete;
+
+ private:
+    const std::string_view i_name;
+    const std::string_view i_detail;
+    clock_type::time_point i_start;
+};
+
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Add the time spent in its scope to a phase, if collecting,
+// and trace it if tracing
+class ScopedTimer final
+{
+ public:
+    ScopedTimer(FileStats* const st, const Phase phase) noexcept
+      : i_stats(st)
+      , i_phase(phase)
+       {
+        if( i_stats ) i_start = clock_type::now();
+       }
+
+    ~ScopedTimer() noexcept
+       {
+        if( i_stats )
+           {
+            const auto t_end = clock_type::now();
+            const auto idx = static_cast<std::size_t>(i_phase);
+            i_stats->seconds[idx] += std::chrono::duration<double>(t_end - i_start).count();
+            if( tracer ) tracer->add(phases_names[idx], i_stats->name, i_start, t_end);
+           }
+       }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer(ScopedTimer&&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(ScopedTimer&&) = delete;
+
+ private:
+    FileStats* const i_stats;
+    const Phase i_phase;
+    clock_type::time_point i_start;
+};
+
+
+//---------------------------------------------------------------------------
+[[nodiscard]] inline double per_second(const double amount, const double secs) noexcept
+{
+    return secs>0.0 ? amount/secs : 0.0;
+}
+
+//---------------------------------------------------------------------------
+[[nodiscard]] inline double to_mb(const std::size_t bytes) noexcept
+{
+    return static_cast<double>(bytes) / 1048576.0;
+}
+
+
+//---------------------------------------------------------------------------
+// Human readable report, times in milliseconds.
+// Note: the phases of the total sum the time spent by all the threads,
+//       while throughput is computed on the wall time of the batch
+void print_table(std::ostream& os, const std::vector<FileStats>& files, const double wall_secs)
+{
+    auto print_row = [&os](const std::string_view name, const FileStats& st, const double secs)
+       {
+        os << fmt::format("{:<24} {:>9.2f} {:>8} {:>9.2f} {:>7}"sv, name, to_mb(st.bytes), st.elements, to_mb(st.written_bytes), st.flushes);
+        for( const double s : st.seconds ) os << fmt::format(" {:>12.2f}"sv, s*1000.0);
+        os << fmt::format(" {:>9.2f} {:>8.1f} {:>10.0f}\n"sv, secs*1000.0, per_second(to_mb(st.bytes), secs), per_second(static_cast<double>(st.elements), secs));
+       };
+
+    os << fmt::format("\n{:<24} {:>9} {:>8} {:>9} {:>7}"sv, "file"sv, "MB"sv, "elements"sv, "out MB"sv, "flushes"sv);
+    for( const auto name : phases_names ) os << fmt::format(" {:>12}"sv, name);
+    os << fmt::format(" {:>9} {:>8} {:>10}\n"sv, "total"sv, "MB/s"sv, "elements/s"sv);
+
+    FileStats tot;
+    for( const auto& file : files )
+       {
+        print_row(file.name, file, file.total_seconds());
+        tot.accumulate(file);
+       }
+    print_row(fmt::format("[{} files, wall time]"sv, files.size()), tot, wall_secs);
+}
+
+
+//---------------------------------------------------------------------------
+// Machine readable report, times in seconds
+void print_json(std::ostream& os, const std::vector<FileStats>& files, const double wall_secs)
+{
+    auto print_counts = [&os](const FileStats& st)
+       {
+        os << fmt::format("\"bytes\":{},\"elements\":{},\"written_bytes\":{},\"flushes\":{},\"phases\":{{"sv, st.bytes, st.elements, st.written_bytes, st.flushes);
+        for( std::size_t i=0; i<phases_count; ++i )
+           {
+            os << fmt::format("{}\"{}\":{:.6f}"sv, i>0 ? ","sv : ""sv, phases_names[i], st.seconds[i]);
+           }
+        os << "}"sv;
+       };
+
+    FileStats tot;
+    os << "{\"files\":["sv;
+    for( std::size_t k=0; k<files.size(); ++k )
+       {
+        const auto& file = files[k];
+        const double secs = file.total_seconds();
+        os << fmt::format("{}\n{{\"name\":\"{}\","sv, k>0 ? ","sv : ""sv, json_escape(file.name));
+        print_counts(file);
+        os << fmt::format(",\"seconds\":{:.6f},\"mb_per_s\":{:.3f},\"elements_per_s\":{:.1f}}}"sv, secs, per_second(to_mb(file.bytes), secs), per_second(static_cast<double>(file.elements), secs));
+        tot.accumulate(file);
+       }
+    os << fmt::format("],\n\"total\":{{\"files\":{},"sv, files.size());
+    print_counts(tot);
+    os << fmt::format(",\"wall_seconds\":{:.6f},\"mb_per_s\":{:.3f},\"elements_per_s\":{:.1f}}}}}\n"sv, wall_secs, per_second(to_mb(tot.bytes), wall_secs), per_second(static_cast<double>(tot.elements), wall_secs));
+}
+
+
+}//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+
+
+//---- end unit -------------------------------------------------------------
+#endif
@@ -6,14 +6,17 @@
     DEPENDENCIES:
     --------------------------------------------- */
 #include <cassert> // assert
-#include <cctype> // std::isdigit, std::tolower, ...
 #include <string>
 #include <string_view>
 #include <charconv> // std::from_chars
 #include <optional> // std::optional
+#include <cstdint> // std::uint64_t
+#include <cstring> // std::memcpy
 
 #include <fmt/core.h> // fmt::format
 
+#include "ascii.hpp" // ascii::to_lower
+
 using namespace std::literals; // "..."sv
 
 
@@ -50,7 +53,7 @@ std::string replace_extension( const std::string& pth, std::string_view newext )
 // Change string to lowercase
 inline std::string tolower(std::string s)
 {
-    for(char& c : s) c = static_cast<char>(std::tolower(c));
+    for(char& c : s) c = ascii::to_lower(c);
     // With c++20 ranges:
     //s |= action::transform([](unsigned char c){ return std::tolower(c); });
     return s;
@@ -165,6 +168,38 @@ std::size_t hash(const std::string_view s)
 }
 
 
+//---------------------------------------------------------------------------
+// A fast 64 bit hash of a byte buffer, to detect content changes
+// (eight bytes at a time, not meant for cryptographic purposes)
+std::uint64_t hash64(const std::string_view s) noexcept
+{
+    constexpr std::uint64_t k = 0x9E3779B97F4A7C15ull;
+    auto mix = [](std::uint64_t h, const std::uint64_t w) noexcept -> std::uint64_t
+       {
+        h ^= w * k;
+        return ((h << 27) | (h >> 37)) * 0xBF58476D1CE4E5B9ull;
+       };
+
+    std::uint64_t h = s.size() * k;
+    std::size_t i = 0;
+    for( ; i+8<=s.size(); i+=8 )
+       {
+        std::uint64_t w;
+        std::memcpy(&w, s.data()+i, 8);
+        h = mix(h, w);
+       }
+    std::uint64_t tail = 0;
+    for( std::size_t j=0; i<s.size(); ++i, j+=8 ) tail |= static_cast<std::uint64_t>(static_cast<unsigned char>(s[i])) << j;
+    h = mix(h, tail);
+
+    // Final avalanche
+    h ^= h >> 31;
+    h *= 0x94D049BB133111EBull;
+    h ^= h >> 29;
+    return h;
+}
+
+
 //-----------------------------------------------------------------------
 // Returns true if text matches glob-like pattern with wildcards (*, ?)
 bool glob_match(const char* text, const char* glob, const char dont_match ='/')
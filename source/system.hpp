@@ -19,20 +19,37 @@
     #include <Windows.h>
     //#include <unistd.h> // _stat
     #include <shellapi.h> // FindExecutableA
+    #include <io.h> // _open, _write, _close
+    #include <fcntl.h> // _O_WRONLY, ...
+    #include <sys/stat.h> // _S_IWRITE, ...
   #else
     #include <fcntl.h> // open
     #include <sys/mman.h> // mmap, munmap
     #include <sys/stat.h> // fstat
     #include <unistd.h> // unlink
+    #include <sys/uio.h> // writev
+    #include <sys/inotify.h> // inotify_*
+    #include <poll.h> // poll
   #endif
+    #include <cerrno> // errno
+    #include <cstring> // std::memcpy
+    #include <climits> // IOV_MAX
     #include <string>
     #include <string_view>
+    #include <vector>
+    #include <unordered_map>
+    #include <map>
     #include <tuple>
     #include <stdexcept>
-    #include <cstdio> // std::fopen, ...
+    #include <cstdio> // std::remove, ...
     #include <cstdlib> // std::getenv
+    #include <exception> // std::uncaught_exceptions
+    #include <atomic> // std::atomic
+    #include <mutex> // std::mutex, std::scoped_lock
+    #include <memory> // std::unique_ptr
+    #include <algorithm> // std::min
     //#include <fstream>
-    //#include <chrono> // std::chrono::system_clock
+    #include <chrono> // std::chrono::steady_clock
     //using namespace std::chrono_literals; // 1s, 2h, ...
     #include <ctime> // std::time_t, std::strftime
 
@@ -296,7 +313,49 @@ void edit_text_file(const std::string& pth, const std::size_t offset) noexcept
 class MemoryMappedFile final
 {
  public:
-    explicit MemoryMappedFile( const std::string& pth )
+    // Below this size a plain read is cheaper than mapping and faulting
+    // the pages in: the break-even given by test/read-bench.cpp
+    static constexpr std::size_t read_threshold = 256u * 1024u;
+
+    struct standard_input_t {};
+    static constexpr standard_input_t standard_input{};
+
+    //-----------------------------------------------------------------------
+    // Read the standard input until closed in a growing buffer,
+    // since a pipe can't be mapped
+    explicit MemoryMappedFile( standard_input_t )
+       {
+      #ifdef MS_WINDOWS
+        ::_setmode(0, _O_BINARY);
+      #endif
+        i_read_cap = read_threshold;
+        i_read_buf = std::make_unique_for_overwrite<char[]>(i_read_cap);
+        while( true )
+           {
+            if( i_bufsiz==i_read_cap )
+               {
+                auto bigger_buf = std::make_unique_for_overwrite<char[]>(2*i_read_cap);
+                std::memcpy(bigger_buf.get(), i_read_buf.get(), i_bufsiz);
+                i_read_buf = std::move(bigger_buf);
+                i_read_cap *= 2;
+               }
+          #ifdef MS_WINDOWS
+            const int n = ::_read(0, i_read_buf.get()+i_bufsiz, static_cast<unsigned int>(std::min<std::size_t>(i_read_cap-i_bufsiz, 0x40000000u)));
+          #else
+            const ssize_t n = ::read(0, i_read_buf.get()+i_bufsiz, i_read_cap-i_bufsiz);
+          #endif
+            if( n==0 ) break; // End of input
+            if( n==-1 )
+               {
+                if( errno==EINTR ) continue;
+                throw std::runtime_error("Cannot read the standard input");
+               }
+            i_bufsiz += static_cast<std::size_t>(n);
+           }
+        i_buf = i_read_buf.get();
+       }
+
+    explicit MemoryMappedFile( const std::string& pth, [[maybe_unused]] const bool populate =false )
        {
       #ifdef MS_WINDOWS
         hFile = ::CreateFileA(pth.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_READONLY, nullptr);
@@ -326,21 +385,40 @@ class MemoryMappedFile final
 
         // obtain file size
         struct stat sbuf {};
-        if(fstat(fd, &sbuf) == -1) throw std::logic_error("Cannot stat file size");
+        if(fstat(fd, &sbuf) == -1)
+           {
+            ::close(fd);
+            throw std::logic_error("Cannot stat file size");
+           }
         i_bufsiz = static_cast<std::size_t>(sbuf.st_size);
 
-        i_buf = static_cast<const char*>(mmap(nullptr, i_bufsiz, PROT_READ, MAP_PRIVATE, fd, 0U));
+        if( i_bufsiz<read_threshold )
+           {// Small file, just read it
+            read_all(fd);
+            ::close(fd);
+            return;
+           }
+
+        i_buf = static_cast<const char*>(mmap(nullptr, i_bufsiz, PROT_READ, MAP_PRIVATE | (populate ? MAP_POPULATE : 0), fd, 0U));
+        ::close(fd); // The mapping stays valid
         if(i_buf == MAP_FAILED)
            {
             i_buf = nullptr;
             throw std::runtime_error("Cannot map file");
            }
+        // Will be scanned once from the start
+        ::madvise(const_cast<char*>(i_buf), i_bufsiz, MADV_SEQUENTIAL);
+        if( !populate ) ::madvise(const_cast<char*>(i_buf), i_bufsiz, MADV_WILLNEED);
       #endif
        }
 
     ~MemoryMappedFile() noexcept
        {
-        if(i_buf)
+        if( i_read_buf )
+           {
+            if( i_read_cap==read_threshold ) give_back(std::move(i_read_buf));
+           }
+        else if(i_buf)
            {
           #ifdef MS_WINDOWS
             ::UnmapViewOfFile(i_buf);
@@ -361,6 +439,8 @@ class MemoryMappedFile final
     MemoryMappedFile(MemoryMappedFile&& other) noexcept
       : i_bufsiz(other.i_bufsiz)
       , i_buf(other.i_buf)
+      , i_read_buf(std::move(other.i_read_buf))
+      , i_read_cap(other.i_read_cap)
     #ifdef MS_WINDOWS
       , hFile(other.hFile)
       , hMapping(other.hMapping)
@@ -381,36 +461,300 @@ class MemoryMappedFile final
     [[nodiscard]] const char* end() const noexcept { return i_buf + i_bufsiz; }
     [[nodiscard]] std::string_view as_string_view() const noexcept { return std::string_view{i_buf, i_bufsiz}; }
 
+    [[nodiscard]] bool is_mapped() const noexcept { return i_buf && !i_read_buf; }
+
+    //-----------------------------------------------------------------------
+    // Fault in the whole mapping reading a byte for each page
+    void prefetch() const noexcept
+       {
+        if( !is_mapped() ) return; // Already in memory
+        constexpr std::size_t page_siz = 4096u;
+        unsigned char acc = 0;
+        for( std::size_t i=0; i<i_bufsiz; i+=page_siz ) acc ^= static_cast<unsigned char>(static_cast<const volatile char*>(i_buf)[i]);
+        [[maybe_unused]] volatile unsigned char sink = acc;
+       }
+
  private:
     std::size_t i_bufsiz = 0;
     const char* i_buf = nullptr;
+    std::unique_ptr<char[]> i_read_buf; // If read instead of mapped
+    std::size_t i_read_cap = 0; // Of 'i_read_buf'
   #ifdef MS_WINDOWS
     HANDLE hFile = INVALID_HANDLE_VALUE;
     HANDLE hMapping = nullptr;
+  #else
+    //-----------------------------------------------------------------------
+    // The buffers of the small files, shared by the threads since
+    // a file can be read by a thread and released by another
+    struct buffers_pool_t
+       {
+        std::mutex mtx;
+        std::vector<std::unique_ptr<char[]>> bufs;
+       };
+    [[nodiscard]] static buffers_pool_t& buffers_pool() noexcept
+       {
+        static buffers_pool_t pool;
+        return pool;
+       }
+
+    //-----------------------------------------------------------------------
+    void read_all(const int fd)
+       {
+           {
+            auto& pool = buffers_pool();
+            const std::scoped_lock lock(pool.mtx);
+            if( !pool.bufs.empty() )
+               {
+                i_read_buf = std::move(pool.bufs.back());
+                pool.bufs.pop_back();
+               }
+           }
+        if( !i_read_buf ) i_read_buf = std::make_unique_for_overwrite<char[]>(read_threshold);
+        i_read_cap = read_threshold;
+        i_buf = i_read_buf.get();
+
+        std::size_t got = 0;
+        while( got<i_bufsiz )
+           {
+            const ssize_t n = ::read(fd, i_read_buf.get()+got, i_bufsiz-got);
+            if( n==0 ) break; // Shrunk meanwhile
+            if( n==-1 )
+               {
+                if( errno==EINTR ) continue;
+                ::close(fd);
+                throw std::runtime_error("Cannot read file");
+               }
+            got += static_cast<std::size_t>(n);
+           }
+        i_bufsiz = got;
+       }
   #endif
+
+    //-----------------------------------------------------------------------
+    static void give_back(std::unique_ptr<char[]>&& buf) noexcept
+       {
+      #ifndef MS_WINDOWS
+        constexpr std::size_t max_pooled = 16; // About the files in flight
+        auto& pool = buffers_pool();
+        const std::scoped_lock lock(pool.mtx);
+        if( pool.bufs.size()<max_pooled )
+           {
+            try{ pool.bufs.push_back(std::move(buf)); } catch(...) {}
+           }
+      #endif
+       }
 };
 
 
 
+//---------------------------------------------------------------------------
+// The single I/O operations are passed to this hook, set
+// when tracing (see 'stats::Tracer'), can be called by any thread
+using io_trace_t = void (*)(std::string_view name, std::string_view detail, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end) noexcept;
+inline io_trace_t io_trace = nullptr;
+
 /////////////////////////////////////////////////////////////////////////////
-// (Over)Write a file
-class file_write final
+// An I/O operation, lasting the scope, passed to 'io_trace'
+class io_span final
 {
  public:
-    explicit file_write(const std::string& pth)
+    explicit io_span(const std::string_view name, const std::string_view detail ={}) noexcept
+      : i_name(name)
+      , i_detail(detail)
+       {
+        if( io_trace ) i_start = std::chrono::steady_clock::now();
+       }
+
+    ~io_span() noexcept
+       {
+        if( io_trace ) io_trace(i_name, i_detail, i_start, std::chrono::steady_clock::now());
+       }
+
+    io_span(const io_span&) = delete;
+    io_span(io_span&&) = delete;
+    io_span& operator=(const io_span&) = delete;
+    io_span& operator=(io_span&&) = delete;
+
+ private:
+    const std::string_view i_name;
+    const std::string_view i_detail;
+    std::chrono::steady_clock::time_point i_start;
+};
+
+
+//---------------------------------------------------------------------------
+// Data written to files by the current thread
+struct write_counters_t
+{
+    std::size_t bytes = 0;
+    std::size_t flushes = 0; // Calls to the system
+};
+[[nodiscard]] inline write_counters_t& thread_write_counters() noexcept
+{
+    thread_local write_counters_t c;
+    return c;
+}
+
+
+
+/////////////////////////////////////////////////////////////////////////////
+// A temporary file in the same directory of a target file,
+// that replaces the target when committed, so the target is
+// never seen truncated. If not committed, it's discarded.
+// A symbolic link is written through, replacing the file it
+// points to; the mode (and owner, if allowed) of an existing
+// target are kept (not on Windows)
+class replacing_file final
+{
+ public:
+    explicit replacing_file(const std::string& pth)
+      : i_path(link_target(pth))
+      , i_tmp_path(temp_path_for(i_path))
        {
       #ifdef MS_WINDOWS
-        const errno_t err = fopen_s(&i_File, pth.c_str(), "wb"); // "a" for append
-        if(err) throw std::runtime_error("Cannot write to: " + pth);
+        i_fd = ::_open(i_tmp_path.c_str(), _O_RDWR | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+        if(i_fd == -1) throw std::runtime_error("Cannot write to: " + pth);
       #else
-        i_File = fopen(pth.c_str(), "wb"); // "a" for append
-        if(!i_File) throw std::runtime_error("Cannot write to: " + pth);
+        i_fd = ::open(i_tmp_path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+        if(i_fd == -1) throw std::runtime_error("Cannot write to: " + pth);
+        copy_attributes(i_fd, i_path);
       #endif
        }
 
+    ~replacing_file() noexcept
+       {
+        if( i_fd!=-1 )
+           {
+            close_fd();
+            std::remove(i_tmp_path.c_str());
+           }
+       }
+
+    replacing_file(const replacing_file&) = delete;
+    replacing_file(replacing_file&&) = delete;
+    replacing_file& operator=(const replacing_file&) = delete;
+    replacing_file& operator=(replacing_file&&) = delete;
+
+    [[nodiscard]] int fd() const noexcept { return i_fd; }
+    [[nodiscard]] bool is_open() const noexcept { return i_fd!=-1; }
+    [[nodiscard]] const std::string& path() const noexcept { return i_path; }
+
+    //-----------------------------------------------------------------------
+    // Replace the target if the content was successfully written
+    void commit(const bool written_ok)
+       {
+        if( i_fd==-1 ) return;
+        const bool ok = close_fd() && written_ok;
+        std::error_code ec;
+        if( ok ) fs::rename(i_tmp_path, i_path, ec);
+        if( !ok || ec )
+           {
+            std::remove(i_tmp_path.c_str());
+            throw std::runtime_error("Cannot write to: " + i_path);
+           }
+       }
+
+    //-----------------------------------------------------------------------
+    // Unique in the process, since more threads may write the same file
+    [[nodiscard]] static std::string temp_path_for(const std::string& pth)
+       {
+        static std::atomic<unsigned int> count{0};
+      #ifdef MS_WINDOWS
+        const auto pid = ::GetCurrentProcessId();
+      #else
+        const auto pid = ::getpid();
+      #endif
+        return pth + ".~" + std::to_string(pid) + '-' + std::to_string(count++);
+       }
+
+    //-----------------------------------------------------------------------
+    // Give the temporary file the attributes of the replaced one, if any
+    static void copy_attributes([[maybe_unused]] const int fd, [[maybe_unused]] const std::string& target) noexcept
+       {
+      #ifndef MS_WINDOWS
+        if( struct stat st{}; ::stat(target.c_str(), &st)==0 )
+           {
+            [[maybe_unused]] const int owned = ::fchown(fd, st.st_uid, st.st_gid); // Allowed only to privileged users
+            ::fchmod(fd, st.st_mode & 07777);
+           }
+      #endif
+       }
+
+    //-----------------------------------------------------------------------
+    // The file to be replaced: the one pointed by a symbolic link
+    [[nodiscard]] static std::string link_target(const std::string& pth)
+       {
+        std::error_code ec;
+        if( !fs::is_symlink(pth, ec) ) return pth;
+        const fs::path target = fs::canonical(pth, ec);
+        if( !ec ) return target.string();
+        // Dangling, the link is followed once
+        fs::path dest = fs::read_symlink(pth, ec);
+        if( ec ) return pth;
+        if( dest.is_relative() ) dest = fs::path(pth).parent_path() / dest;
+        return dest.string();
+       }
+
+ private:
+    std::string i_path;
+    std::string i_tmp_path;
+    int i_fd = -1;
+
+    //-----------------------------------------------------------------------
+    bool close_fd() noexcept
+       {
+      #ifdef MS_WINDOWS
+        const bool closed = ::_close(i_fd)==0;
+      #else
+        const bool closed = ::close(i_fd)==0;
+      #endif
+        i_fd = -1;
+        return closed;
+       }
+};
+
+
+
+/////////////////////////////////////////////////////////////////////////////
+// (Over)Write a file, atomically (see 'replacing_file').
+// If destroyed during stack unwinding the target is left untouched.
+// The many small fragments are collected in a big buffer, reused
+// by the files written in sequence by the same thread, and passed
+// to the system with plain write calls
+class file_write final
+{
+ public:
+    static constexpr std::size_t buffer_size = 256u * 1024u;
+
+    explicit file_write(const std::string& pth)
+      : i_file(pth)
+       {
+        // Borrow the thread buffer, if not already in use
+        thread_buffer& tb = local_buffer();
+        if( !tb.in_use )
+           {
+            if( !tb.data ) tb.data = std::make_unique_for_overwrite<char[]>(buffer_size);
+            tb.in_use = true;
+            i_buf = tb.data.get();
+           }
+        else
+           {
+            i_own_buf = std::make_unique_for_overwrite<char[]>(buffer_size);
+            i_buf = i_own_buf.get();
+           }
+       }
+
     ~file_write() noexcept
        {
-        fclose(i_File);
+        if( !i_file.is_open() ) return; // Already closed
+        if( std::uncaught_exceptions()>i_uncaught_exceptions )
+           {// Something went wrong, 'i_file' will be discarded
+            release_buffer();
+           }
+        else
+           {// Best effort, can't report errors here
+            try{ close(); } catch(...) {}
+           }
        }
 
     file_write(const file_write&) = delete;
@@ -418,29 +762,509 @@ class file_write final
     file_write& operator=(const file_write&) = delete;
     file_write& operator=(file_write&&) = delete;
 
-    const file_write& operator<<(const char c) const noexcept
+    file_write& operator<<(const char c) noexcept
+       {
+        if( i_used==buffer_size ) flush();
+        i_buf[i_used++] = c;
+        return *this;
+       }
+
+    file_write& operator<<(const std::string_view s) noexcept
+       {
+        if( s.empty() ) return *this; // May have no data
+        if( s.size() > buffer_size-i_used )
+           {
+            flush();
+            if( s.size()>=buffer_size )
+               {// Too big to be buffered
+                write_all(s.data(), s.size());
+                return *this;
+               }
+           }
+        std::memcpy(i_buf+i_used, s.data(), s.size());
+        i_used += s.size();
+        return *this;
+       }
+
+    //-----------------------------------------------------------------------
+    // Replace the target with the written content
+    void close()
+       {
+        if( !i_file.is_open() ) return;
+        flush();
+        release_buffer();
+        i_file.commit(!i_failed);
+       }
+
+ private:
+    struct thread_buffer
+       {
+        std::unique_ptr<char[]> data;
+        bool in_use = false;
+       };
+
+    replacing_file i_file;
+    char* i_buf = nullptr;
+    std::unique_ptr<char[]> i_own_buf; // If the thread buffer was busy
+    std::size_t i_used = 0;
+    bool i_failed = false;
+    int i_uncaught_exceptions = std::uncaught_exceptions();
+
+    [[nodiscard]] static thread_buffer& local_buffer() noexcept { thread_local thread_buffer tb; return tb; }
+
+    //-----------------------------------------------------------------------
+    void flush() noexcept
+       {
+        if( i_used>0 )
+           {
+            write_all(i_buf, i_used);
+            i_used = 0;
+           }
+       }
+
+    //-----------------------------------------------------------------------
+    void write_all(const char* data, std::size_t siz) noexcept
+       {
+        const io_span span("write", i_file.path());
+        thread_write_counters().bytes += siz;
+        ++thread_write_counters().flushes;
+        while( siz>0 && !i_failed )
+           {
+          #ifdef MS_WINDOWS
+            const int n = ::_write(i_file.fd(), data, static_cast<unsigned int>(std::min<std::size_t>(siz, 0x40000000u)));
+          #else
+            const ssize_t n = ::write(i_file.fd(), data, siz);
+          #endif
+            if( n==-1 )
+               {
+                if( errno==EINTR ) continue;
+                i_failed = true;
+               }
+            else
+               {
+                data += n;
+                siz -= static_cast<std::size_t>(n);
+               }
+           }
+       }
+
+    //-----------------------------------------------------------------------
+    void release_buffer() noexcept
+       {
+        if( i_buf && !i_own_buf ) local_buffer().in_use = false;
+        i_buf = nullptr;
+       }
+};
+
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Write a file of a known size filling a memory mapping of it,
+// atomically (see 'replacing_file'). The whole size is allocated
+// upfront, writing more or less than declared is an error
+class mapped_file_write final
+{
+ public:
+    mapped_file_write(const std::string& pth, const std::size_t siz)
+      : i_file(pth)
+      , i_size(siz)
+       {
+      #ifdef MS_WINDOWS
+        throw std::runtime_error("Mapped output not yet supported on Windows");
+      #else
+        if( i_size==0 ) return; // Nothing to map
+        const auto len = static_cast<off_t>(i_size);
+        if( ::posix_fallocate(i_file.fd(), 0, len)!=0 && ::ftruncate(i_file.fd(), len)==-1 )
+           {
+            throw std::runtime_error("Cannot allocate " + std::to_string(i_size) + " bytes for: " + pth);
+           }
+        void* const p = ::mmap(nullptr, i_size, PROT_READ | PROT_WRITE, MAP_SHARED, i_file.fd(), 0);
+        if( p==MAP_FAILED ) throw std::runtime_error("Cannot map: " + pth);
+        i_buf = static_cast<char*>(p);
+      #endif
+       }
+
+    ~mapped_file_write() noexcept
+       {
+        if( !i_file.is_open() ) return; // Already closed
+        if( std::uncaught_exceptions()>i_uncaught_exceptions )
+           {// Something went wrong, 'i_file' will be discarded
+            unmap();
+           }
+        else
+           {// Best effort, can't report errors here
+            try{ close(); } catch(...) {}
+           }
+       }
+
+    mapped_file_write(const mapped_file_write&) = delete;
+    mapped_file_write(mapped_file_write&&) = delete;
+    mapped_file_write& operator=(const mapped_file_write&) = delete;
+    mapped_file_write& operator=(mapped_file_write&&) = delete;
+
+    mapped_file_write& operator<<(const char c) noexcept
+       {
+        if( i_used<i_size ) i_buf[i_used] = c;
+        ++i_used;
+        return *this;
+       }
+
+    mapped_file_write& operator<<(const std::string_view s) noexcept
+       {
+        if( !s.empty() && s.size()<=i_size-std::min(i_used, i_size) ) std::memcpy(i_buf+i_used, s.data(), s.size());
+        i_used += s.size();
+        return *this;
+       }
+
+    //-----------------------------------------------------------------------
+    // Replace the target with the written content
+    void close()
+       {
+        if( !i_file.is_open() ) return;
+        unmap();
+        thread_write_counters().bytes += i_size;
+        ++thread_write_counters().flushes;
+        if( i_used!=i_size )
+           {
+            i_file.commit(false); // Discards and throws
+           }
+        i_file.commit(true);
+       }
+
+ private:
+    replacing_file i_file;
+    const std::size_t i_size; // Declared
+    std::size_t i_used = 0; // Written so far
+    char* i_buf = nullptr;
+    int i_uncaught_exceptions = std::uncaught_exceptions();
+
+    //-----------------------------------------------------------------------
+    void unmap() noexcept
+       {
+      #ifndef MS_WINDOWS
+        if( i_buf ) ::munmap(i_buf, i_size);
+      #endif
+        i_buf = nullptr;
+       }
+};
+
+
+
+/////////////////////////////////////////////////////////////////////////////
+// A view that stays valid until the output is closed, typically
+// into the mapped input file. Plain writers see it as a string_view,
+// 'gather_write' can avoid copying it
+struct lasting_view final
+{
+    std::string_view s;
+    operator std::string_view() const noexcept { return s; }
+};
+
+
+/////////////////////////////////////////////////////////////////////////////
+// (Over)Write a file atomically (see 'replacing_file') with a single
+// gathered write: the generated fragments are collected in an arena,
+// while the big lasting views are just referenced
+class gather_write final
+{
+ public:
+    static constexpr std::size_t chunk_size = 64u * 1024u;
+    static constexpr std::size_t min_referenced_size = 512u; // Smaller ones are copied
+
+    explicit gather_write(const std::string& pth)
+      : i_file(pth)
+       {
+      #ifdef MS_WINDOWS
+        throw std::runtime_error("Gathered output not yet supported on Windows");
+      #endif
+       }
+
+    ~gather_write() noexcept
        {
-        fputc(c, i_File);
+        if( !i_file.is_open() ) return; // Already closed
+        if( std::uncaught_exceptions()==i_uncaught_exceptions )
+           {// Best effort, can't report errors here
+            try{ close(); } catch(...) {}
+           }
+       }
+
+    gather_write(const gather_write&) = delete;
+    gather_write(gather_write&&) = delete;
+    gather_write& operator=(const gather_write&) = delete;
+    gather_write& operator=(gather_write&&) = delete;
+
+    gather_write& operator<<(const char c)
+       {
+        copy(&c, 1);
         return *this;
        }
 
-    const file_write& operator<<(const std::string_view s) const noexcept
+    gather_write& operator<<(const std::string_view s)
        {
-        fwrite(s.data(), sizeof(std::string_view::value_type), s.length(), i_File);
+        copy(s.data(), s.size());
         return *this;
        }
 
-    const file_write& operator<<(const std::string& s) const noexcept
+    gather_write& operator<<(const lasting_view v)
        {
-        fwrite(s.data(), sizeof(std::string::value_type), s.length(), i_File);
+        if( v.s.size()<min_referenced_size ) copy(v.s.data(), v.s.size());
+        else add_fragment(v.s.data(), v.s.size());
         return *this;
        }
 
+    //-----------------------------------------------------------------------
+    // Replace the target with the collected fragments
+    void close()
+       {
+        if( !i_file.is_open() ) return;
+        i_file.commit( write_fragments() );
+       }
+
  private:
-    FILE* i_File;
+    struct fragment_t
+       {
+        const char* data;
+        std::size_t size;
+       };
+
+    replacing_file i_file;
+    std::vector<fragment_t> i_fragments;
+    std::vector<std::unique_ptr<char[]>> i_chunks; // The copied content
+    char* i_chunk = nullptr; // The one being filled
+    std::size_t i_chunk_used = 0;
+    int i_uncaught_exceptions = std::uncaught_exceptions();
+
+    //-----------------------------------------------------------------------
+    void copy(const char* const data, const std::size_t siz)
+       {
+        if( siz==0 ) return;
+        if( siz>chunk_size )
+           {// A dedicated chunk, the one being filled stays as it is
+            i_chunks.push_back( std::make_unique_for_overwrite<char[]>(siz) );
+            std::memcpy(i_chunks.back().get(), data, siz);
+            add_fragment(i_chunks.back().get(), siz);
+            return;
+           }
+        if( !i_chunk || siz>chunk_size-i_chunk_used )
+           {
+            i_chunks.push_back( std::make_unique_for_overwrite<char[]>(chunk_size) );
+            i_chunk = i_chunks.back().get();
+            i_chunk_used = 0;
+           }
+        char* const dst = i_chunk + i_chunk_used;
+        std::memcpy(dst, data, siz);
+        i_chunk_used += siz;
+        add_fragment(dst, siz);
+       }
+
+    //-----------------------------------------------------------------------
+    void add_fragment(const char* const data, const std::size_t siz)
+       {
+        if( siz==0 ) return;
+        if( !i_fragments.empty() && i_fragments.back().data+i_fragments.back().size==data )
+           {// Contiguous to the previous
+            i_fragments.back().size += siz;
+           }
+        else
+           {
+            i_fragments.push_back( fragment_t{data, siz} );
+           }
+       }
+
+    //-----------------------------------------------------------------------
+    [[nodiscard]] bool write_fragments() noexcept
+       {
+      #ifdef MS_WINDOWS
+        return false;
+      #else
+        std::vector<iovec> iov;
+        iov.reserve(i_fragments.size());
+        for( const auto& frag : i_fragments ) iov.push_back( iovec{const_cast<char*>(frag.data), frag.size} );
+
+        std::size_t i = 0;
+        while( i<iov.size() )
+           {
+            const int cnt = static_cast<int>(std::min<std::size_t>(iov.size()-i, IOV_MAX));
+            const io_span span("writev", i_file.path());
+            const ssize_t n = ::writev(i_file.fd(), iov.data()+i, cnt);
+            if( n==-1 )
+               {
+                if( errno==EINTR ) continue;
+                return false;
+               }
+            ++thread_write_counters().flushes;
+            thread_write_counters().bytes += static_cast<std::size_t>(n);
+            // Skip what was written, a partial write may end inside a fragment
+            auto left = static_cast<std::size_t>(n);
+            while( i<iov.size() && left>=iov[i].iov_len ) left -= iov[i++].iov_len;
+            if( left>0 )
+               {
+                iov[i].iov_base = static_cast<char*>(iov[i].iov_base) + left;
+                iov[i].iov_len -= left;
+               }
+           }
+        return true;
+      #endif
+       }
+};
+
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Just count the output size, same interface of 'file_write'
+class count_write final
+{
+ public:
+    count_write& operator<<(const char) noexcept
+       {
+        ++i_size;
+        return *this;
+       }
+
+    count_write& operator<<(const std::string_view s) noexcept
+       {
+        i_size += s.size();
+        return *this;
+       }
+
+    [[nodiscard]] std::size_t size() const noexcept { return i_size; }
+
+ private:
+    std::size_t i_size = 0;
+};
+
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Collect the output in memory, same interface of 'file_write'
+class string_write final
+{
+ public:
+    explicit string_write(const std::size_t siz =0)
+       {
+        i_buf.reserve(siz);
+       }
+
+    string_write& operator<<(const char c)
+       {
+        i_buf.push_back(c);
+        return *this;
+       }
+
+    string_write& operator<<(const std::string_view s)
+       {
+        i_buf.append(s);
+        return *this;
+       }
+
+    [[nodiscard]] std::string_view view() const noexcept { return i_buf; }
+    [[nodiscard]] std::string take() noexcept { return std::move(i_buf); }
+
+ private:
+    std::string i_buf;
+};
+
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Collect the output in an anonymous temporary file, to be copied
+// elsewhere later, when too big to be kept in memory.
+// Same interface of 'file_write', deleted when destroyed
+class temp_write final
+{
+ public:
+    temp_write()
+      : i_file(std::tmpfile())
+       {
+        if( !i_file ) throw std::runtime_error("Cannot create a temporary file");
+       }
+
+    ~temp_write() noexcept
+       {
+        std::fclose(i_file);
+       }
+
+    temp_write(const temp_write&) = delete;
+    temp_write(temp_write&&) = delete;
+    temp_write& operator=(const temp_write&) = delete;
+    temp_write& operator=(temp_write&&) = delete;
+
+    temp_write& operator<<(const char c)
+       {
+        put(&c, 1);
+        return *this;
+       }
+
+    temp_write& operator<<(const std::string_view s)
+       {
+        put(s.data(), s.size());
+        return *this;
+       }
+
+    [[nodiscard]] bool is_empty() const noexcept { return i_size==0; }
+
+    //-----------------------------------------------------------------------
+    // Write the whole content to another writer
+    template<typename W> void copy_to(W& f)
+       {
+        if( std::fflush(i_file)!=0 || std::fseek(i_file, 0, SEEK_SET)!=0 ) throw std::runtime_error("Cannot read a temporary file");
+        const auto buf = std::make_unique_for_overwrite<char[]>(chunk_size);
+        while( const std::size_t n = std::fread(buf.get(), 1, chunk_size, i_file) )
+           {
+            f << std::string_view(buf.get(), n);
+           }
+        if( std::ferror(i_file) ) throw std::runtime_error("Cannot read a temporary file");
+        std::fseek(i_file, 0, SEEK_END);
+       }
+
+ private:
+    static constexpr std::size_t chunk_size = 64u * 1024u;
+    std::FILE* i_file;
+    std::size_t i_size = 0;
+
+    void put(const char* const buf, const std::size_t siz)
+       {
+        if( std::fwrite(buf, 1, siz, i_file)!=siz ) throw std::runtime_error("Cannot write a temporary file");
+        i_size += siz;
+       }
 };
 
 
+//---------------------------------------------------------------------------
+// Flush to disk all the written data of the filesystem
+// containing a path, cheaper than syncing each file
+void sync_filesystem(const fs::path& pth)
+{
+  #ifdef MS_WINDOWS
+    // No equivalent without administrative rights, files
+    // are flushed by the system lazy writer
+    (void)pth;
+  #else
+    const int fd = ::open(pth.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd == -1) throw std::runtime_error("Cannot open " + pth.string());
+    const int ret = ::syncfs(fd);
+    ::close(fd);
+    if(ret == -1) throw std::runtime_error("Cannot sync the filesystem of " + pth.string());
+  #endif
+}
+
+
+//---------------------------------------------------------------------------
+// Let the system start reading a file in background, so
+// the following accesses won't wait the disk. Just a hint
+void advise_will_read(const fs::path& pth) noexcept
+{
+  #ifdef MS_WINDOWS
+    (void)pth; // Left to the system cache manager
+  #else
+    const int fd = ::open(pth.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd == -1) return;
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+    ::close(fd);
+  #endif
+}
+
+
 //---------------------------------------------------------------------------
 // Formatted time stamp
 //std::string human_readable_time_stamp(const std::filesystem::file_time_type ftime)
@@ -456,8 +1280,14 @@ std::string human_readable_time_stamp(const std::time_t t)
 {
     //return fmt::format("{:%Y-%m-%d}", std::localtime(&t));
     //std::formatter()
+    std::tm tm_buf{}; // std::localtime is not thread safe
+  #ifdef MS_WINDOWS
+    ::localtime_s(&tm_buf, &t);
+  #else
+    ::localtime_r(&t, &tm_buf);
+  #endif
     char buf[64];
-    std::size_t len = std::strftime(buf, sizeof(buf), "%F %T", std::localtime(&t));
+    std::size_t len = std::strftime(buf, sizeof(buf), "%F %T", &tm_buf);
         // %F  equivalent to "%Y-%m-%d" (the ISO 8601 date format)
         // %T  equivalent to "%H:%M:%S" (the ISO 8601 time format)
     return std::string(buf, len);
@@ -598,6 +1428,54 @@ std::vector<fs::path> file_glob(const fs::path pth)
 
 
 
+//---------------------------------------------------------------------------
+// Expand many paths at once: the ones with wildcards in the same
+// directory are matched in a single scan of its content.
+// Returns the matches of each path, in the same order
+std::vector<std::vector<fs::path>> file_glob(const std::vector<fs::path>& pths)
+{
+    std::vector<std::vector<fs::path>> result(pths.size());
+    std::map<fs::path, std::vector<std::size_t>> globs_by_dir; // directory -> indexes of the globs
+    std::vector<std::string> filename_globs(pths.size());
+    for( std::size_t i=0; i<pths.size(); ++i )
+       {
+        if( str::contains_wildcards(pths[i].parent_path().string()) )
+           {
+            throw std::runtime_error("sys::file_glob: Wildcards in directories not supported");
+           }
+        filename_globs[i] = pths[i].filename().string();
+        if( str::contains_wildcards(filename_globs[i]) )
+           {
+            fs::path parent_folder = pths[i].parent_path();
+            if( parent_folder.empty() ) parent_folder = fs::current_path();
+            globs_by_dir[parent_folder].push_back(i);
+           }
+        else
+           {// Nothing to glob
+            result[i].push_back(pths[i]);
+           }
+       }
+
+    for( const auto& [parent_folder, idxs] : globs_by_dir )
+       {
+        if( !fs::exists(parent_folder) ) continue;
+        for( const auto& entry : fs::directory_iterator(parent_folder, fs::directory_options::follow_directory_symlink |
+                                                                       fs::directory_options::skip_permission_denied) )
+           {
+            if( !entry.is_regular_file() ) continue;
+            const std::string filename = entry.path().filename().string();
+            for( const std::size_t i : idxs )
+               {
+                if( str::glob_match(filename.c_str(), filename_globs[i].c_str()) ) result[i].push_back( entry.path() );
+               }
+           }
+       }
+
+    return result;
+}
+
+
+
 //---------------------------------------------------------------------------
 // ex. const auto removed_count = remove_all_inside(fs::temp_directory_path(), std::regex{R"-(^.*\.(tmp)$)-"});
 //std::size_t remove_all_inside(const std::filesystem::path& dir, std::regex&& reg)
@@ -624,7 +1502,7 @@ std::vector<fs::path> file_glob(const fs::path pth)
 
 //---------------------------------------------------------------------------
 // ex. const auto removed_count = remove_files_inside(fs::temp_directory_path(), std::regex{R"-(^.*\.(tmp)$)-"});
-std::size_t remove_files_inside(const std::filesystem::path& dir, std::regex&& reg)
+std::size_t remove_files_inside(const std::filesystem::path& dir, const std::regex& reg)
 {
     std::size_t removed_items_count { 0 };
 
@@ -646,6 +1524,132 @@ std::size_t remove_files_inside(const std::filesystem::path& dir, std::regex&& r
 
 
 
+/////////////////////////////////////////////////////////////////////////////
+// Notifies when some files are written.
+// The parent directories are watched rather than the files,
+// since many editors save replacing the file with a new one
+class FilesWatcher final
+{
+ public:
+    FilesWatcher()
+       {
+      #ifdef MS_WINDOWS
+        throw std::runtime_error("Watching files not yet supported on Windows");
+      #else
+        i_fd = ::inotify_init1(IN_CLOEXEC);
+        if(i_fd == -1) throw std::runtime_error("Cannot initialize inotify");
+      #endif
+       }
+
+    ~FilesWatcher() noexcept
+       {
+      #ifndef MS_WINDOWS
+        if(i_fd != -1) ::close(i_fd);
+      #endif
+       }
+
+    FilesWatcher(const FilesWatcher&) = delete;
+    FilesWatcher(FilesWatcher&&) = delete;
+    FilesWatcher& operator=(const FilesWatcher&) = delete;
+    FilesWatcher& operator=(FilesWatcher&&) = delete;
+
+    //-----------------------------------------------------------------------
+    // Watch a file, will be notified with the index of addition
+    void add(const fs::path& pth)
+       {
+      #ifndef MS_WINDOWS
+        const fs::path abs_pth = fs::absolute(pth).lexically_normal();
+        const fs::path dir = abs_pth.parent_path();
+        const int wd = ::inotify_add_watch(i_fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+        if(wd == -1) throw std::runtime_error("Cannot watch " + dir.string());
+        i_dirs.try_emplace(wd, dir);
+        i_files.try_emplace(abs_pth.string(), i_count);
+      #endif
+        ++i_count;
+       }
+
+    //-----------------------------------------------------------------------
+    // Block until some of the watched files are written, then wait
+    // until things settle down to collect the whole burst of changes.
+    // Returns the sorted indexes of the written files
+    [[nodiscard]] std::vector<std::size_t> wait_changes(const int settle_ms)
+       {
+        std::vector<bool> changed(i_count, false);
+      #ifndef MS_WINDOWS
+        bool any = false;
+        int timeout_ms = -1; // Block until the first event
+        while( true )
+           {
+            pollfd pfd{ i_fd, POLLIN, 0 };
+            const int ret = ::poll(&pfd, 1, timeout_ms);
+            if( ret==-1 )
+               {
+                if( errno==EINTR ) continue;
+                throw std::runtime_error("Cannot poll inotify events");
+               }
+            if( ret==0 ) break; // Settled
+            if( read_events(changed) ) any = true;
+            if( any ) timeout_ms = settle_ms;
+           }
+      #endif
+        std::vector<std::size_t> indexes;
+        for( std::size_t i=0; i<changed.size(); ++i )
+           {
+            if( changed[i] ) indexes.push_back(i);
+           }
+        return indexes;
+       }
+
+ private:
+  #ifndef MS_WINDOWS
+    int i_fd = -1;
+    std::unordered_map<int, fs::path> i_dirs; // Watch descriptor -> directory
+    std::unordered_map<std::string, std::size_t> i_files; // Absolute path -> index
+  #endif
+    std::size_t i_count = 0; // Added files
+
+  #ifndef MS_WINDOWS
+    //-----------------------------------------------------------------------
+    // Returns true if some watched file was written
+    bool read_events(std::vector<bool>& changed)
+       {
+        alignas(inotify_event) char buf[4096];
+        const ssize_t len = ::read(i_fd, buf, sizeof(buf));
+        if( len<=0 ) return false;
+
+        bool any = false;
+        const std::size_t siz = static_cast<std::size_t>(len);
+        for( std::size_t i=0; i<siz; )
+           {
+            inotify_event ev;
+            std::memcpy(&ev, buf+i, sizeof(ev));
+            if( ev.mask & IN_Q_OVERFLOW )
+               {// Lost track, consider everything changed
+                changed.assign(changed.size(), true);
+                any = true;
+               }
+            else if( ev.len>0 )
+               {
+                const auto dir = i_dirs.find(ev.wd);
+                if( dir!=i_dirs.end() )
+                   {
+                    const auto file = i_files.find( (dir->second / (buf+i+sizeof(inotify_event))).string() );
+                    if( file!=i_files.end() )
+                       {
+                        changed[file->second] = true;
+                        any = true;
+                       }
+                   }
+               }
+            i += sizeof(inotify_event) + ev.len;
+           }
+        return any;
+       }
+  #endif
+};
+
+
+
 //---------------------------------------------------------------------------
 // Append string to existing file using c++ streams
 //void append_to_file(const std::string_view path, const std::string_view txt)
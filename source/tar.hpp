@@ -0,0 +1,263 @@
+#ifndef GUARD_tar_hpp
+#define GUARD_tar_hpp
+/*  ---------------------------------------------
+    ©2022 matteo.gattanini@gmail.com
+
+    OVERVIEW
+    ---------------------------------------------
+    Listing the files contained in a tar archive
+    (ustar, with GNU and pax long names), as views
+    into the archive content, and writing one
+
+    FORMAT
+    ---------------------------------------------
+    <header:512 bytes> <content padded to 512 bytes>
+    ...
+    <two zeroed blocks>
+
+    DEPENDENCIES:
+    --------------------------------------------- */
+#include <cstdint> // std::uint64_t
+#include <string>
+#include <string_view>
+#include <vector>
+#include <stdexcept> // std::runtime_error
+#include <mutex> // std::mutex, std::scoped_lock
+#include <ctime> // std::time
+#include <algorithm> // std::copy_n, std::min
+#include <fmt/core.h> // fmt::format
+
+#include "system.hpp" // sys::file_write
+
+using namespace std::literals; // "..."sv
+
+
+//:::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+namespace tar //:::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+{
+
+inline constexpr std::size_t block_size = 512;
+
+struct Member
+{
+    std::string name; // Path inside the archive
+    std::string_view content; // Refers to the archive buffer
+};
+
+
+//---------------------------------------------------------------------------
+// A zero terminated field
+[[nodiscard]] constexpr std::string_view field(const std::string_view hdr, const std::size_t offset, const std::size_t len) noexcept
+{
+    const std::string_view f = hdr.substr(offset, len);
+    return f.substr(0, f.find('\0'));
+}
+
+
+//---------------------------------------------------------------------------
+// Numeric fields are octal, or base-256 if the first bit is set
+[[nodiscard]] std::uint64_t number(const std::string_view f)
+{
+    std::uint64_t n = 0;
+    if( !f.empty() && (static_cast<unsigned char>(f[0]) & 0x80u) )
+       {
+        for( std::size_t i=1; i<f.size(); ++i ) n = (n << 8) | static_cast<unsigned char>(f[i]);
+        return n;
+       }
+    for( const char ch : f )
+       {
+        if( ch>='0' && ch<='7' ) n = (n << 3) | static_cast<std::uint64_t>(ch - '0');
+        else if( ch!=' ' && ch!='\0' ) throw std::runtime_error(fmt::format("Invalid number in tar header: {}"sv, f));
+       }
+    return n;
+}
+
+
+//---------------------------------------------------------------------------
+// The checksum is the sum of the header bytes, with its own field as spaces
+[[nodiscard]] bool is_checksum_ok(const std::string_view hdr)
+{
+    std::uint64_t sum = 0;
+    for( std::size_t i=0; i<block_size; ++i )
+       {
+        sum += (i>=148 && i<156) ? static_cast<unsigned char>(' ') : static_cast<unsigned char>(hdr[i]);
+       }
+    return sum==number(hdr.substr(148, 8));
+}
+
+
+//---------------------------------------------------------------------------
+// The 'path' record of a pax extended header: "<len> path=<value>\n"
+[[nodiscard]] std::string_view pax_path(std::string_view records) noexcept
+{
+    while( !records.empty() )
+       {
+        std::size_t len = 0;
+        std::size_t i = 0;
+        while( i<records.size() && records[i]>='0' && records[i]<='9' ) len = 10*len + static_cast<std::size_t>(records[i++] - '0');
+        if( len==0 || len>records.size() ) break; // Malformed
+        const std::string_view rec = records.substr(i+1, len-i-1); // "key=value\n"
+        if( rec.starts_with("path="sv) ) return rec.substr(5, rec.size()-6);
+        records.remove_prefix(len);
+       }
+    return {};
+}
+
+
+//---------------------------------------------------------------------------
+// The regular files in the archive, directories and links are skipped
+[[nodiscard]] std::vector<Member> list_files(const std::string_view archive)
+{
+    std::vector<Member> members;
+    std::string long_name; // From a previous GNU or pax entry
+    std::size_t pos = 0;
+    while( pos+block_size<=archive.size() )
+       {
+        const std::string_view hdr = archive.substr(pos, block_size);
+        if( hdr.find_first_not_of('\0')==std::string_view::npos ) break; // End of archive
+        if( !is_checksum_ok(hdr) ) throw std::runtime_error(fmt::format("Corrupted tar header at offset {}"sv, pos));
+
+        const std::uint64_t siz = number(hdr.substr(124, 12));
+        pos += block_size;
+        if( siz>archive.size()-pos ) throw std::runtime_error(fmt::format("Truncated tar archive at offset {}"sv, pos));
+        const std::string_view content = archive.substr(pos, static_cast<std::size_t>(siz));
+        pos += (static_cast<std::size_t>(siz) + block_size - 1) / block_size * block_size;
+
+        switch( hdr[156] )
+           {
+            case 'L' : // GNU long name of the next entry
+                long_name = field(content, 0, content.size());
+                continue;
+
+            case 'x' : // pax extended header of the next entry
+                long_name = pax_path(content);
+                continue;
+
+            case '0' : case '\0' : case '7' : // Regular file
+                if( !long_name.empty() )
+                   {
+                    members.push_back( Member{ std::move(long_name), content } );
+                   }
+                else
+                   {
+                    const std::string_view prefix = field(hdr, 257, 6)=="ustar"sv ? field(hdr, 345, 155) : std::string_view{}; // Not in GNU format
+                    const std::string_view name = field(hdr, 0, 100);
+                    members.push_back( Member{ prefix.empty() ? std::string(name) : fmt::format("{}/{}"sv, prefix, name), content } );
+                   }
+                break;
+
+            default : // Directories, links, devices, ...
+                break;
+           }
+        long_name.clear();
+       }
+    return members;
+}
+
+
+//---------------------------------------------------------------------------
+// Write a header block of an entry
+template<typename W> void write_header(W& f, const std::string_view name, const std::size_t siz, const char type, const std::time_t mtime)
+{
+    char hdr[block_size] = {};
+    auto put = [&hdr](const std::size_t offset, const std::string_view s) noexcept
+       {
+        std::copy_n(s.data(), s.size(), hdr+offset);
+       };
+    auto put_octal = [&put](const std::size_t offset, const std::size_t len, const std::uint64_t n)
+       {// Zero padded, terminated
+        put(offset, fmt::format("{:0{}o}"sv, n, len-1));
+       };
+
+    put(0, name.substr(0, std::min<std::size_t>(name.size(), 100)));
+    put_octal(100, 8, 0644); // mode
+    put_octal(108, 8, 0); // uid
+    put_octal(116, 8, 0); // gid
+    put_octal(124, 12, siz);
+    put_octal(136, 12, static_cast<std::uint64_t>(mtime));
+    hdr[156] = type;
+    put(257, "ustar\0" "00"sv);
+
+    std::uint64_t sum = 0;
+    for( std::size_t i=0; i<block_size; ++i ) sum += (i>=148 && i<156) ? static_cast<unsigned char>(' ') : static_cast<unsigned char>(hdr[i]);
+    put(148, fmt::format("{:06o}"sv, sum));
+    hdr[155] = ' ';
+
+    f << std::string_view(hdr, block_size);
+}
+
+
+//---------------------------------------------------------------------------
+// Write the content of an entry, padded to the block size
+template<typename W> void write_padded(W& f, const std::string_view content)
+{
+    static constexpr char zeros[block_size] = {};
+    f << content;
+    if( const std::size_t rem = content.size() % block_size; rem>0 ) f << std::string_view(zeros, block_size-rem);
+}
+
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Regular files appended to an archive by any thread,
+// in a single sequentially written file (see 'sys::file_write').
+// While existing, it's reachable through 'output'
+class ArchiveWriter;
+inline ArchiveWriter* output = nullptr; // Not null when writing an archive
+
+class ArchiveWriter final
+{
+ public:
+    explicit ArchiveWriter(const std::string& pth)
+      : i_file(pth)
+       {
+        output = this;
+       }
+
+    ~ArchiveWriter() noexcept
+       {
+        output = nullptr;
+       }
+
+    ArchiveWriter(const ArchiveWriter&) = delete;
+    ArchiveWriter(ArchiveWriter&&) = delete;
+    ArchiveWriter& operator=(const ArchiveWriter&) = delete;
+    ArchiveWriter& operator=(ArchiveWriter&&) = delete;
+
+    //-----------------------------------------------------------------------
+    void add(const std::string_view name, const std::string_view content)
+       {
+        const std::scoped_lock lock(i_mtx);
+        if( name.size()>100 )
+           {// GNU long name entry
+            const std::string long_name{ std::string(name) + '\0' };
+            write_header(i_file, "././@LongLink"sv, long_name.size(), 'L', i_mtime);
+            write_padded(i_file, long_name);
+           }
+        write_header(i_file, name, content.size(), '0', i_mtime);
+        write_padded(i_file, content);
+       }
+
+    //-----------------------------------------------------------------------
+    // Terminate the archive and replace the target
+    void close()
+       {
+        static constexpr char zeros[2*block_size] = {};
+        const std::scoped_lock lock(i_mtx);
+        i_file << std::string_view(zeros, sizeof(zeros));
+        i_file.close();
+       }
+
+ private:
+    sys::file_write i_file;
+    std::mutex i_mtx;
+    const std::time_t i_mtime = std::time(nullptr);
+};
+
+
+}//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+
+
+//---- end unit -------------------------------------------------------------
+#endif
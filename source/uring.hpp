@@ -0,0 +1,465 @@
+#ifndef GUARD_uring_hpp
+#define GUARD_uring_hpp
+/*  ---------------------------------------------
+    ©2022 matteo.gattanini@gmail.com
+
+    OVERVIEW
+    ---------------------------------------------
+    Batched output writes through io_uring (Linux),
+    falling back to plain writes when unavailable.
+    Each output is a chain of asynchronous steps:
+    open temporary → write... → close → rename
+
+    DEPENDENCIES:
+    --------------------------------------------- */
+#include "system.hpp" // MS_WINDOWS, sys::*, fs::*
+
+#ifndef MS_WINDOWS
+  #include <linux/io_uring.h> // io_uring_*
+  #include <sys/syscall.h> // __NR_io_uring_*
+  #include <sys/mman.h> // mmap, munmap
+  #include <fcntl.h> // AT_FDCWD, O_*
+  #include <unistd.h> // syscall, close
+#endif
+#include <cerrno> // errno
+#include <cstring> // std::memset
+#include <cstdint> // std::uint64_t
+#include <atomic> // std::atomic_ref
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <memory> // std::unique_ptr
+#include <utility> // std::exchange
+#include <mutex> // std::mutex, std::scoped_lock
+#include <algorithm> // std::min, std::erase_if
+#include <chrono> // std::chrono::steady_clock
+
+
+//:::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+namespace aio //:::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+{
+
+#ifndef MS_WINDOWS
+/////////////////////////////////////////////////////////////////////////////
+// Minimal io_uring instance over the raw system calls
+class Ring final
+{
+ public:
+    explicit Ring(const unsigned int entries) noexcept
+       {
+        io_uring_params p;
+        std::memset(&p, 0, sizeof(p));
+        const long fd = ::syscall(__NR_io_uring_setup, entries, &p);
+        if( fd<0 ) return; // Not available (old kernel, seccomp, ...)
+        i_fd = static_cast<int>(fd);
+
+        i_sq_ring_size = p.sq_off.array + p.sq_entries*sizeof(unsigned int);
+        i_cq_ring_size = p.cq_off.cqes + p.cq_entries*sizeof(io_uring_cqe);
+        if( p.features & IORING_FEAT_SINGLE_MMAP ) i_sq_ring_size = i_cq_ring_size = std::max(i_sq_ring_size, i_cq_ring_size);
+        i_sq_ring = map(i_sq_ring_size, IORING_OFF_SQ_RING);
+        i_cq_ring = (p.features & IORING_FEAT_SINGLE_MMAP) ? i_sq_ring : map(i_cq_ring_size, IORING_OFF_CQ_RING);
+        i_sqes_size = p.sq_entries*sizeof(io_uring_sqe);
+        i_sqes = static_cast<io_uring_sqe*>(map(i_sqes_size, IORING_OFF_SQES));
+        if( !i_sq_ring || !i_cq_ring || !i_sqes )
+           {
+            release();
+            return;
+           }
+
+        i_sq_tail = at<unsigned int>(i_sq_ring, p.sq_off.tail);
+        i_sq_head = at<unsigned int>(i_sq_ring, p.sq_off.head);
+        i_sq_mask = *at<unsigned int>(i_sq_ring, p.sq_off.ring_mask);
+        i_sq_array = at<unsigned int>(i_sq_ring, p.sq_off.array);
+        i_sq_entries = p.sq_entries;
+        i_cq_head = at<unsigned int>(i_cq_ring, p.cq_off.head);
+        i_cq_tail = at<unsigned int>(i_cq_ring, p.cq_off.tail);
+        i_cq_mask = *at<unsigned int>(i_cq_ring, p.cq_off.ring_mask);
+        i_cqes = at<io_uring_cqe>(i_cq_ring, p.cq_off.cqes);
+        i_cq_entries = p.cq_entries;
+       }
+
+    ~Ring() noexcept
+       {
+        release();
+       }
+
+    Ring(const Ring&) = delete;
+    Ring(Ring&&) = delete;
+    Ring& operator=(const Ring&) = delete;
+    Ring& operator=(Ring&&) = delete;
+
+    [[nodiscard]] bool available() const noexcept { return i_fd!=-1; }
+    [[nodiscard]] unsigned int completions_capacity() const noexcept { return i_cq_entries; }
+    [[nodiscard]] unsigned int to_submit() const noexcept { return i_to_submit; }
+
+    //-----------------------------------------------------------------------
+    // A zeroed submission entry, null if the queue is full
+    [[nodiscard]] io_uring_sqe* get_sqe() noexcept
+       {
+        const unsigned int head = std::atomic_ref<unsigned int>(*i_sq_head).load(std::memory_order_acquire);
+        if( i_sqe_tail-head>=i_sq_entries ) return nullptr;
+        const unsigned int idx = i_sqe_tail & i_sq_mask;
+        io_uring_sqe* const sqe = i_sqes + idx;
+        std::memset(sqe, 0, sizeof(*sqe));
+        i_sq_array[idx] = idx;
+        ++i_sqe_tail;
+        ++i_to_submit;
+        std::atomic_ref<unsigned int>(*i_sq_tail).store(i_sqe_tail, std::memory_order_release);
+        return sqe;
+       }
+
+    //-----------------------------------------------------------------------
+    // Pass the queued entries to the kernel, optionally waiting a completion
+    [[nodiscard]] bool submit(const bool wait) noexcept
+       {
+        while( true )
+           {
+            const long n = ::syscall(__NR_io_uring_enter, i_fd, i_to_submit, wait ? 1u : 0u, wait ? IORING_ENTER_GETEVENTS : 0u, nullptr, 0);
+            if( n>=0 )
+               {
+                i_to_submit -= static_cast<unsigned int>(n);
+                return true;
+               }
+            if( errno!=EINTR && errno!=EAGAIN && errno!=EBUSY ) return false;
+            if( !wait ) return true; // Retry later
+           }
+       }
+
+    //-----------------------------------------------------------------------
+    // Consume the available completions: (user_data, result)
+    template<typename F> void reap(F on_completion)
+       {
+        unsigned int head = *i_cq_head;
+        const unsigned int tail = std::atomic_ref<unsigned int>(*i_cq_tail).load(std::memory_order_acquire);
+        while( head!=tail )
+           {
+            const io_uring_cqe& cqe = i_cqes[head & i_cq_mask];
+            const std::uint64_t user_data = cqe.user_data;
+            const int res = cqe.res;
+            ++head;
+            std::atomic_ref<unsigned int>(*i_cq_head).store(head, std::memory_order_release);
+            on_completion(user_data, res);
+           }
+       }
+
+ private:
+    int i_fd = -1;
+    void* i_sq_ring = nullptr;
+    void* i_cq_ring = nullptr;
+    io_uring_sqe* i_sqes = nullptr;
+    std::size_t i_sq_ring_size = 0;
+    std::size_t i_cq_ring_size = 0;
+    std::size_t i_sqes_size = 0;
+    unsigned int* i_sq_tail = nullptr;
+    unsigned int* i_sq_head = nullptr;
+    unsigned int* i_sq_array = nullptr;
+    unsigned int i_sq_mask = 0;
+    unsigned int i_sq_entries = 0;
+    unsigned int i_sqe_tail = 0; // Local copy
+    unsigned int i_to_submit = 0;
+    unsigned int* i_cq_head = nullptr;
+    unsigned int* i_cq_tail = nullptr;
+    io_uring_cqe* i_cqes = nullptr;
+    unsigned int i_cq_mask = 0;
+    unsigned int i_cq_entries = 0;
+
+    template<typename T> [[nodiscard]] static T* at(void* const base, const unsigned int offset) noexcept
+       {
+        return reinterpret_cast<T*>(static_cast<char*>(base) + offset);
+       }
+
+    [[nodiscard]] void* map(const std::size_t siz, const off_t offset) const noexcept
+       {
+        void* const p = ::mmap(nullptr, siz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, i_fd, offset);
+        return p==MAP_FAILED ? nullptr : p;
+       }
+
+    void release() noexcept
+       {
+        if( i_sqes ) ::munmap(i_sqes, i_sqes_size);
+        if( i_cq_ring && i_cq_ring!=i_sq_ring ) ::munmap(i_cq_ring, i_cq_ring_size);
+        if( i_sq_ring ) ::munmap(i_sq_ring, i_sq_ring_size);
+        i_sqes = nullptr;
+        i_sq_ring = i_cq_ring = nullptr;
+        if( i_fd!=-1 ) ::close(i_fd);
+        i_fd = -1;
+       }
+};
+#endif
+
+
+
+/////////////////////////////////////////////////////////////////////////////
+// Outputs generated in memory by any thread, queued to be written
+// together. While existing, it's reachable through 'outputs'
+class OutputsBatch;
+inline OutputsBatch* outputs = nullptr; // Not null when batching
+
+class OutputsBatch final
+{
+ public:
+    static constexpr unsigned int queue_depth = 64;
+    static constexpr unsigned int submit_threshold = 16; // Operations per system call
+    static constexpr std::size_t max_pending_bytes = 64u * 1024u * 1024u; // Then wait
+
+    OutputsBatch() noexcept
+       {
+        outputs = this;
+       }
+
+    ~OutputsBatch() noexcept
+       {
+        try{ static_cast<void>(finish()); } catch(...) {} // If not already finished
+        outputs = nullptr;
+       }
+
+    OutputsBatch(const OutputsBatch&) = delete;
+    OutputsBatch(OutputsBatch&&) = delete;
+    OutputsBatch& operator=(const OutputsBatch&) = delete;
+    OutputsBatch& operator=(OutputsBatch&&) = delete;
+
+    //-----------------------------------------------------------------------
+    [[nodiscard]] bool uses_ring() const noexcept
+       {
+      #ifdef MS_WINDOWS
+        return false;
+      #else
+        return i_ring.available();
+      #endif
+       }
+
+    //-----------------------------------------------------------------------
+    // Queue the writing of a file, can be called by any thread
+    void add(const std::string& pth, std::string&& content)
+       {
+        if( !uses_ring() )
+           {// Plain synchronous write
+            sys::file_write f(pth);
+            f << content;
+            f.close();
+            return;
+           }
+        sys::thread_write_counters().bytes += content.size();
+      #ifndef MS_WINDOWS
+        const std::scoped_lock lock(i_mtx);
+        auto entry = std::make_unique<Entry>();
+        entry->path = sys::replacing_file::link_target(pth);
+        entry->tmp_path = sys::replacing_file::temp_path_for(entry->path);
+        entry->content = std::move(content);
+        i_pending_bytes += entry->content.size();
+        i_ready.push_back(entry.get());
+        i_entries.push_back(std::move(entry));
+        if( !progress(i_pending_bytes>max_pending_bytes) ) abandon_all();
+      #endif
+       }
+
+    //-----------------------------------------------------------------------
+    // Wait all the queued writes, returns the outputs that failed
+    [[nodiscard]] std::vector<std::string> finish()
+       {
+      #ifndef MS_WINDOWS
+        const std::scoped_lock lock(i_mtx);
+        while( !i_entries.empty() )
+           {
+            if( !progress(true) ) abandon_all();
+           }
+      #endif
+        return std::exchange(i_failed, {});
+       }
+
+ private:
+    std::vector<std::string> i_failed;
+
+    //-----------------------------------------------------------------------
+    // The synchronous way, also the fallback
+    static bool write_now(const std::string& pth, const std::string_view content) noexcept
+       {
+        try{
+            sys::file_write f(pth);
+            f << content;
+            f.close();
+            return true;
+           }
+        catch(...)
+           {
+            return false;
+           }
+       }
+
+  #ifndef MS_WINDOWS
+    enum class Step : std::uint8_t { open, write, close };
+    struct Entry
+       {
+        std::string path;
+        std::string tmp_path;
+        std::string content;
+        std::size_t written = 0;
+        int fd = -1;
+        Step step = Step::open;
+        bool done = false;
+        std::chrono::steady_clock::time_point prepared; // When tracing
+       };
+
+    Ring i_ring{queue_depth};
+    std::mutex i_mtx;
+    std::vector<std::unique_ptr<Entry>> i_entries; // In progress
+    std::deque<Entry*> i_ready; // Waiting a free submission slot
+    unsigned int i_in_flight = 0;
+    std::size_t i_pending_bytes = 0;
+
+    //-----------------------------------------------------------------------
+    // Submit what's ready and handle the completions,
+    // false if the ring is no more usable
+    [[nodiscard]] bool progress(const bool wait)
+       {
+        fill_submissions();
+        if( wait || i_ring.to_submit()>=submit_threshold )
+           {
+            const sys::io_span span("uring-submit");
+            if( !i_ring.submit(wait && i_in_flight>0) ) return false;
+            ++sys::thread_write_counters().flushes;
+           }
+        i_ring.reap([this](const std::uint64_t user_data, const int res){ on_completion(reinterpret_cast<Entry*>(user_data), res); });
+        std::erase_if(i_entries, [](const auto& e) noexcept { return e->done; });
+        fill_submissions();
+        return true;
+       }
+
+    //-----------------------------------------------------------------------
+    void fill_submissions() noexcept
+       {
+        while( !i_ready.empty() && i_in_flight<i_ring.completions_capacity() )
+           {
+            io_uring_sqe* const sqe = i_ring.get_sqe();
+            if( !sqe ) break;
+            Entry* const entry = i_ready.front();
+            i_ready.pop_front();
+            prepare(*sqe, *entry);
+            ++i_in_flight;
+           }
+       }
+
+    //-----------------------------------------------------------------------
+    static void prepare(io_uring_sqe& sqe, Entry& entry) noexcept
+       {
+        sqe.user_data = reinterpret_cast<std::uint64_t>(&entry);
+        if( sys::io_trace ) entry.prepared = std::chrono::steady_clock::now();
+        switch( entry.step )
+           {
+            case Step::open :
+                sqe.opcode = static_cast<std::uint8_t>(IORING_OP_OPENAT);
+                sqe.fd = AT_FDCWD;
+                sqe.addr = reinterpret_cast<std::uint64_t>(entry.tmp_path.c_str());
+                sqe.len = 0666;
+                sqe.open_flags = static_cast<unsigned int>(O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC);
+                break;
+
+            case Step::write :
+                sqe.opcode = static_cast<std::uint8_t>(IORING_OP_WRITE);
+                sqe.fd = entry.fd;
+                sqe.addr = reinterpret_cast<std::uint64_t>(entry.content.data() + entry.written);
+                sqe.len = static_cast<unsigned int>(std::min<std::size_t>(entry.content.size()-entry.written, 0x40000000u));
+                sqe.off = entry.written;
+                break;
+
+            case Step::close :
+                sqe.opcode = static_cast<std::uint8_t>(IORING_OP_CLOSE);
+                sqe.fd = entry.fd;
+                break;
+           }
+       }
+
+    //-----------------------------------------------------------------------
+    void on_completion(Entry* const entry, const int res)
+       {
+        --i_in_flight;
+        trace_step(*entry);
+        switch( entry->step )
+           {
+            case Step::open :
+                if( res<0 ) { fallback(*entry); return; } // Maybe unsupported operation
+                entry->fd = res;
+                sys::replacing_file::copy_attributes(res, entry->path);
+                entry->step = entry->content.empty() ? Step::close : Step::write;
+                break;
+
+            case Step::write :
+                if( res==-EINTR || res==-EAGAIN ) break; // Again
+                if( res<=0 )
+                   {
+                    ::close(entry->fd);
+                    std::remove(entry->tmp_path.c_str());
+                    fallback(*entry);
+                    return;
+                   }
+                entry->written += static_cast<std::size_t>(res);
+                if( entry->written>=entry->content.size() ) entry->step = Step::close;
+                break;
+
+            case Step::close :
+               {
+                std::error_code ec;
+                if( res>=0 ) fs::rename(entry->tmp_path, entry->path, ec);
+                if( res<0 || ec )
+                   {
+                    std::remove(entry->tmp_path.c_str());
+                    i_failed.push_back(entry->path);
+                   }
+                set_done(*entry);
+               }
+                return;
+           }
+        i_ready.push_back(entry); // Next step
+       }
+
+    //-----------------------------------------------------------------------
+    // An operation from its preparation to its completion
+    static void trace_step(const Entry& entry) noexcept
+       {
+        if( !sys::io_trace ) return;
+        const std::string_view name = entry.step==Step::open ? "uring-open" : entry.step==Step::write ? "uring-write" : "uring-close";
+        sys::io_trace(name, entry.path, entry.prepared, std::chrono::steady_clock::now());
+       }
+
+    //-----------------------------------------------------------------------
+    void fallback(Entry& entry)
+       {
+        if( !write_now(entry.path, entry.content) ) i_failed.push_back(entry.path);
+        set_done(entry);
+       }
+
+    //-----------------------------------------------------------------------
+    void set_done(Entry& entry) noexcept
+       {
+        entry.done = true;
+        i_pending_bytes -= entry.content.size();
+        entry.content = std::string{};
+       }
+
+    //-----------------------------------------------------------------------
+    // The ring broke: nothing will complete, write the rest synchronously.
+    // The operations already in the kernel may leave temporary files
+    void abandon_all()
+       {
+        for( auto& entry : i_entries )
+           {
+            if( entry->done ) continue;
+            if( entry->fd!=-1 ) ::close(entry->fd);
+            if( entry->step!=Step::open ) std::remove(entry->tmp_path.c_str());
+            fallback(*entry);
+           }
+        i_entries.clear();
+        i_ready.clear();
+        i_in_flight = 0;
+       }
+  #endif
+};
+
+
+}//::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::::
+
+
+
+//---- end unit -------------------------------------------------------------
+#endif
@@ -0,0 +1,72 @@
+/*  ---------------------------------------------
+    ©2022 matteo.gattanini@gmail.com
+
+    OVERVIEW
+    ---------------------------------------------
+    Microbenchmark of the characters classification:
+    runs of a class, as the parsers loops, with the
+    <cctype> functions and with the 'ascii' table.
+    Not part of the build:
+    $ g++ -std=c++2b -O3 -I../source -o ascii-bench ascii-bench.cpp
+    $ ./ascii-bench test.pll test.h
+
+    DEPENDENCIES:
+    --------------------------------------------- */
+#include <cctype> // std::isspace, ...
+#include <chrono> // std::chrono::steady_clock
+#include <cstdio> // std::printf
+#include <fstream> // std::ifstream
+#include <iterator> // std::istreambuf_iterator
+#include <algorithm> // std::min
+#include <string>
+
+#include "ascii.hpp" // ascii::*
+
+
+//---------------------------------------------------------------------------
+// Best time of many scans of the runs of a class
+template<typename F> double bench(const std::string& s, F is_class, std::size_t& sink)
+{
+    double best = 1e9;
+    for( int r=0; r<30; ++r )
+       {
+        const auto t0 = std::chrono::steady_clock::now();
+        std::size_t n = 0;
+        std::size_t i = 0;
+        while( i<s.size() )
+           {
+            while( i<s.size() && is_class(s[i]) ) ++i;
+            ++n;
+            ++i;
+           }
+        const auto t1 = std::chrono::steady_clock::now();
+        sink += n;
+        best = std::min(best, std::chrono::duration<double,std::milli>(t1-t0).count());
+       }
+    return best;
+}
+
+
+//---------------------------------------------------------------------------
+int main(const int argc, const char* const argv[])
+{
+    std::string s;
+    for( int i=1; i<argc; ++i )
+       {
+        std::ifstream is(argv[i], std::ios::binary);
+        s.append(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>());
+       }
+    if( s.empty() )
+       {
+        std::printf("Usage: ascii-bench <files>...\n");
+        return 2;
+       }
+
+    std::size_t sink = 0; // So the loops aren't optimized away
+    std::printf("%.1f MB, min of 30\n", static_cast<double>(s.size())/1048576.0);
+    std::printf("blank  cctype %6.2fms  table %6.2fms\n", bench(s, [](const char c){ return std::isspace(c) && c!='\n'; }, sink), bench(s, [](const char c){ return ascii::is_blank(c); }, sink));
+    std::printf("alnum  cctype %6.2fms  table %6.2fms\n", bench(s, [](const char c){ return std::isalnum(c)!=0; }, sink), bench(s, [](const char c){ return ascii::is_alnum(c); }, sink));
+    std::printf("ident  cctype %6.2fms  table %6.2fms\n", bench(s, [](const char c){ return std::isalnum(c) || c=='_'; }, sink), bench(s, [](const char c){ return ascii::is_ident(c); }, sink));
+    std::printf("digit  cctype %6.2fms  table %6.2fms\n", bench(s, [](const char c){ return std::isdigit(c)!=0; }, sink), bench(s, [](const char c){ return ascii::is_digit(c); }, sink));
+    return sink==42 ? 1 : 0;
+}
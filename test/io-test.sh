@@ -0,0 +1,19 @@
+#!/bin/sh
+# -----------------------------------------------------------
+# Convert with each output mode and compare the results,
+# big-descr.pll has a fragment longer than a writev chunk
+# $ ./io-test.sh ../linux/build/llconv
+# -----------------------------------------------------------
+llconv=${1:-../linux/build/llconv}
+out_dir=$(mktemp -d) || exit 1
+trap 'rm -rf "$out_dir"' EXIT
+
+for io in buffered mmap writev uring; do
+    mkdir "$out_dir/$io"
+    "$llconv" -io $io big-descr.pll test.pll -output "$out_dir/$io" > /dev/null || { echo "$io failed"; exit 1; }
+done
+
+for io in mmap writev uring; do
+    diff -r "$out_dir/buffered" "$out_dir/$io" > /dev/null || { echo "$io differs"; exit 1; }
+done
+echo "All output modes agree"
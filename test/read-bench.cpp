@@ -0,0 +1,117 @@
+/*  ---------------------------------------------
+    ©2022 matteo.gattanini@gmail.com
+
+    OVERVIEW
+    ---------------------------------------------
+    Microbenchmark of the input loading: a plain read
+    in a reused buffer against a mapping, both scanned
+    once as the parsers do, for files of growing size
+    (in the page cache). The break-even gives the
+    'MemoryMappedFile::read_threshold'.
+    Not part of the build (POSIX):
+    $ g++ -std=c++2b -O3 -o read-bench read-bench.cpp
+    $ ./read-bench /tmp
+
+    DEPENDENCIES:
+    --------------------------------------------- */
+#include <sys/mman.h> // mmap, munmap, madvise
+#include <sys/stat.h> // fstat
+#include <fcntl.h> // open
+#include <unistd.h> // read, write, close
+#include <chrono> // std::chrono::steady_clock
+#include <cstdio> // std::printf, std::remove
+#include <algorithm> // std::min
+#include <memory> // std::unique_ptr
+#include <string>
+
+
+//---------------------------------------------------------------------------
+// Touch each byte, as the parsers do
+std::size_t scan(const char* const buf, const std::size_t siz) noexcept
+{
+    std::size_t n = 0;
+    for( std::size_t i=0; i<siz; ++i ) n += buf[i]=='\n';
+    return n;
+}
+
+
+//---------------------------------------------------------------------------
+std::size_t load_read(const std::string& pth, char* const buf)
+{
+    const int fd = ::open(pth.c_str(), O_RDONLY);
+    struct stat st{};
+    ::fstat(fd, &st);
+    const auto siz = static_cast<std::size_t>(st.st_size);
+    std::size_t got = 0;
+    while( got<siz )
+       {
+        const ssize_t n = ::read(fd, buf+got, siz-got);
+        if( n<=0 ) break;
+        got += static_cast<std::size_t>(n);
+       }
+    ::close(fd);
+    return scan(buf, got);
+}
+
+
+//---------------------------------------------------------------------------
+std::size_t load_mmap(const std::string& pth)
+{
+    const int fd = ::open(pth.c_str(), O_RDONLY);
+    struct stat st{};
+    ::fstat(fd, &st);
+    const auto siz = static_cast<std::size_t>(st.st_size);
+    void* const p = ::mmap(nullptr, siz, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    ::madvise(p, siz, MADV_SEQUENTIAL);
+    ::madvise(p, siz, MADV_WILLNEED);
+    const std::size_t n = scan(static_cast<const char*>(p), siz);
+    ::munmap(p, siz);
+    return n;
+}
+
+
+//---------------------------------------------------------------------------
+// Best time of many loads, in microseconds
+template<typename F> double bench(F load, std::size_t& sink)
+{
+    double best = 1e9;
+    for( int r=0; r<200; ++r )
+       {
+        const auto t0 = std::chrono::steady_clock::now();
+        sink += load();
+        const auto t1 = std::chrono::steady_clock::now();
+        best = std::min(best, std::chrono::duration<double,std::micro>(t1-t0).count());
+       }
+    return best;
+}
+
+
+//---------------------------------------------------------------------------
+int main(const int argc, const char* const argv[])
+{
+    const std::string dir = argc>1 ? argv[1] : ".";
+    const std::string pth = dir + "/read-bench.tmp";
+    constexpr std::size_t max_size = 4u * 1024u * 1024u;
+    const auto buf = std::make_unique_for_overwrite<char[]>(max_size);
+    for( std::size_t i=0; i<max_size; ++i ) buf[i] = (i%64)==63 ? '\n' : 'a';
+
+    std::size_t sink = 0; // So the loops aren't optimized away
+    std::printf("    size      read      mmap  (us, min of 200)\n");
+    for( std::size_t siz=16u*1024u; siz<=max_size; siz*=2 )
+       {
+        const int fd = ::open(pth.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+        if( fd==-1 || ::write(fd, buf.get(), siz)!=static_cast<ssize_t>(siz) )
+           {
+            std::printf("Cannot write %s\n", pth.c_str());
+            return 2;
+           }
+        ::close(fd);
+        const auto rbuf = std::make_unique_for_overwrite<char[]>(siz);
+        const double t_read = bench([&]{ return load_read(pth, rbuf.get()); }, sink);
+        const double t_mmap = bench([&]{ return load_mmap(pth); }, sink);
+        std::printf("%6zuKB %9.1f %9.1f\n", siz/1024u, t_read, t_mmap);
+       }
+    std::remove(pth.c_str());
+    return sink==42 ? 1 : 0;
+}